@@ -16,51 +16,53 @@
 #include "subroutines.h"
 #include "rand.h"
 #include "models.h"
+#include "samplers.h"
+#include "sink.h"
+#include "checkpoint.h"
+#include "profile.h"
+#include "monitor.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* mean functions of the outcome models for the population QoI */
+#define QOI_LOGIT 0
+#define QOI_PROBIT 1
+#define QOI_GAUSSIAN 2
+#define QOI_NEGBIN 3
+#define QOI_TWOPART 4
 
 /*
-  Read the data etc.
+  Read the prior etc.; the designs are read in place (see
+  CompDesigns), except that the outcome models which take row
+  pointers get the rows with observed Y in Xobs, whose leading
+  columns are the indicators of the compliance types in T
 */
 
-void Prep(double *dXc, double **Xc, double *dXo, double **Xo,
-	  double *dXr, double **Xr, double **Xobs, int *R,
-	  int n_samp, int n_obs, int n_covC, int n_covO,
-	  int n_covR, int logitC, int AT, double *dA0C,
-	  double **A0C, double *dA0O, double **A0O, int priorO,
-	  double *dA0R, double **A0R, double *beta0, double *delta0,
-	  double *gamma0, double *pC, double *pN, double *pA,
-	  double *prC, double *prN, double *prA, int *acceptC,
-	  int *acceptR, int n_miss){
+void Prep(double *dXo, double *T, double **Xobs, int *R, int n_samp,
+	  int n_obs, int n_covC, int n_covO, int n_covR, int logitC, int AT,
+	  double *dA0C, double **A0C, double *dA0O, double **A0O,
+	  int priorO, double *dA0R, double **A0R, double *gamma0,
+	  double *pC, double *pN, double *pA, double *prC, double *prN,
+	  double *prA, int *acceptC, int *acceptR){
   int i, j, k;
-  int itemp;
-  double **mtempC = doubleMatrix(n_covC, n_covC); 
+  int itemp, n_lead = AT ? 3 : 2;
   double **mtempO = doubleMatrix(n_covO, n_covO); 
-  double **mtempR = doubleMatrix(n_covR, n_covR); 
 
-  /*** read the data ***/
+  /*** read the rows with observed Y ***/
   itemp = 0;
-  for (j = 0; j < n_covC; j++)
-    for (i = 0; i < n_samp; i++)
-      Xc[i][j] = dXc[itemp++];
-
-  itemp = 0;
-  for (j = 0; j < n_covO; j++)
-    for (i = 0; i < n_samp; i++)
-      Xo[i][j] = dXo[itemp++];
-
-  itemp = 0;
-  for (j = 0; j < n_covR; j++)
-    for (i = 0; i < n_samp; i++)
-      Xr[i][j] = dXr[itemp++];
-
-  itemp = 0;
-  for (i = 0; i < n_samp; i++) 
-    if (R[i] == 1) {
-      for (j = 0; j < n_covO; j++)
-	Xobs[itemp][j] = Xo[i][j];
-      itemp++;
-    }
+  if (Xobs)
+    for (i = 0; i < n_samp; i++) 
+      if (R[i] == 1) {
+	for (j = 0; j < n_lead; j++)
+	  Xobs[itemp][j] = T[i+(size_t)j*n_samp];
+	for (j = n_lead; j < n_covO; j++)
+	  Xobs[itemp][j] = dXo[i+(size_t)(j-n_lead)*n_samp];
+	itemp++;
+      }
 
-  /*** read the prior as additional data points ***/ 
+  /*** read the prior ***/ 
   itemp = 0; 
   if ((logitC == 1) && (AT == 1))
     for (k = 0; k < n_covC*2; k++)
@@ -81,18 +83,8 @@ void Prep(double *dXc, double **Xc, double *dXo, double **Xo,
     for (j = 0; j < n_covR; j++)
       A0R[j][k] = dA0R[itemp++];
 
-  if (logitC != 1) {
-    dcholdc(A0C, n_covC, mtempC);
-    for (i = 0; i < n_covC; i++) {
-      Xc[n_samp+i][n_covC]=0;
-      for (j = 0; j < n_covC; j++) {
-	Xc[n_samp+i][n_covC] += mtempC[i][j]*beta0[j];
-	Xc[n_samp+i][j] = mtempC[i][j];
-      }
-    }
-  }
-
-  if (priorO) {
+  /* as additional data points of Xobs */
+  if (Xobs && priorO) {
     dcholdc(A0O, n_covO, mtempO);
     for (i = 0; i < n_covO; i++) {
       Xobs[n_obs+i][n_covO]=0;
@@ -102,15 +94,6 @@ void Prep(double *dXc, double **Xc, double *dXo, double **Xo,
       }
     }
   }
-  
-  dcholdc(A0R, n_covR, mtempR);
-  for (i = 0; i < n_covR; i++) {
-    Xr[n_samp+i][n_covR]=0;
-    for (j = 0; j < n_covR; j++) {
-      Xr[n_samp+i][n_covR] += mtempR[i][j]*delta0[j];
-      Xr[n_samp+i][j] = mtempR[i][j];
-    }
-  }
 
   /*** starting values for probabilities ***/
   for (i = 0; i < n_samp; i++) {
@@ -127,36 +110,82 @@ void Prep(double *dXc, double **Xc, double *dXo, double **Xo,
   for (j = 0; j < n_covR; j++)
     acceptR[j] = 0;
 
-  FreeMatrix(mtempC, n_covC);
   FreeMatrix(mtempO, n_covO);
-  FreeMatrix(mtempR, n_covR);
  
 } /* end of Prep */
 
 
+/*
+  Designs of the compliance and response models, read in place from
+  R's column-major matrices (see design.c).  The indicators of the
+  compliance types, which SampleComp overwrites, are the leading
+  columns of the response and outcome designs; they are kept in T,
+  which is computed here from C, Z and A and shared by both designs,
+  and dXr (and dXo) hold only the other covariates.  With sparse,
+  these are all compressed sparse columns.  X'X is only computed for
+  the probit models, and DcA is the view of the noncompliers for the
+  probit model of the always-takers (NULL if none).
+*/
+
+void CompDesigns(double *dXc, double *dXr, int *C, int *Z, int *A,
+		 int n_samp, int n_covC, int n_covR, int logitC, int logitR,
+		 int AT, int n_miss, double *dA0C, double *dA0R,
+		 double *beta0, double *delta0, int single, int sparse,
+		 int *spc_p, int *spc_i, double *spc_x, int *spr_p,
+		 int *spr_i, double *spr_x, double **T, colDesign **Dc,
+		 colDesign **DcA, colDesign **Dr){
+  int i, n_lead = AT ? 3 : 2;
+  double *w;
+
+  *T = doubleArray((size_t)n_samp*n_lead);
+  for (i = 0; i < n_samp; i++) {
+    (*T)[i] = (C[i] == 1 && Z[i] == 1);
+    (*T)[i+(size_t)n_samp] = (C[i] == 1 && Z[i] == 0);
+    if (AT)
+      (*T)[i+(size_t)2*n_samp] = (A[i] == 1);
+  }
+  *Dc = DesignOpen(dXc, n_samp, n_covC, sparse ? 0 : n_covC, NULL, 0,
+		   spc_p, spc_i, spc_x, NULL, logitC ? NULL : dA0C, beta0,
+		   single);
+  *Dr = DesignOpen(dXr, n_samp, n_covR, sparse ? n_lead : n_covR, *T,
+		   n_lead, spr_p, spr_i, spr_x, NULL,
+		   (logitR || n_miss == 0) ? NULL : dA0R, delta0, single);
+  *DcA = NULL;
+  if (!logitC && AT) {
+    w = doubleArray(n_samp);
+    for (i = 0; i < n_samp; i++)
+      w[i] = (C[i] == 0);
+    *DcA = DesignView(*Dc, w, dA0C, beta0);
+    free(w);
+  }
+} /* end of CompDesigns */
+
+
 /* 
    Response function 
 */
 
-void Response(int logitR, int *R, double **Xr, double *delta,
-	      int n_samp, int n_covR, double *delta0, double **A0R,
-	      double *VarR, int *acceptR, int mda, int AT,
-	      int *Z, int *D, double *prC, double *prN, double *prA){
+void Response(int logitR, int *R, colDesign *Dr, double *delta,
+	      double *delta0, double **A0R, double *VarR, int *acceptR,
+	      int mda, int AT, int *Z, int *D, double *prC, double *prN,
+	      double *prA, double *refR){
   double dtemp;
-  int i, j;
-
-  if (logitR)
-    logitMetro(R, Xr, delta, n_samp, 1, n_covR, delta0, A0R, VarR,
-	       1, acceptR);
+  int i, n_samp = Dr->n_samp;
+  /* linear predictor without the compliance types */
+  double *eta = doubleArray(n_samp);
+
+  if (logitR && refR)
+    logitMetroSub(R, Dr, delta, refR, 1, delta0, A0R, VarR, 1, acceptR);
+  else if (logitR)
+    logitMetroCol(R, Dr, delta, 1, delta0, A0R, VarR, 1, acceptR);
   else
-    bprobitGibbs(R, Xr, delta, n_samp, n_covR, 0, delta0, A0R, mda, 1);
+    bprobitGibbsCol(R, Dr, delta, mda, 1);
   
   /* Compute probabilities of R = Robs */ 
+  DesignXBeta(Dr, AT ? 3 : 2, Dr->n_cov, delta, eta);
   for (i = 0; i < n_samp; i++) {
-    dtemp = 0;
+    dtemp = eta[i];
     if (AT) { /* always-takers */
-      for (j = 3; j < n_covR; j++)
-	dtemp += Xr[i][j]*delta[j];
       if ((Z[i] == 0) && (D[i] == 0)) {
 	if (logitR) {
 	  prC[i] = R[i]/(1+exp(-dtemp-delta[1])) + 
@@ -184,8 +213,6 @@ void Response(int logitR, int *R, double **Xr, double *delta,
 	}
       }
     } else { /* no always-takers */
-      for (j = 2; j < n_covR; j++)
-	dtemp += Xr[i][j]*delta[j];
       if (Z[i] == 0) {
 	if (logitR) {
 	  prC[i] = R[i]/(1+exp(-dtemp-delta[1])) +
@@ -201,6 +228,7 @@ void Response(int logitR, int *R, double **Xr, double *delta,
       }
     } 
   }
+  free(eta);
 } /* end of Response */
 
 
@@ -208,83 +236,92 @@ void Response(int logitR, int *R, double **Xr, double *delta,
    Compliance prediction
 */
 
-void Compliance(int logitC, int AT, int *C, double **Xc,
-		double *betaC, int n_samp, int n_covC, double *beta0,
+void Compliance(int logitC, int AT, int *C, colDesign *Dc,
+		colDesign *DcA, double *betaC, double *beta0,
 		double **A0C, double *betaA, double *VarC, int *acceptC,
-		int mda, int *A){
-  int i, j; 
-  int itemp;
-  /* subset of the data */
-  int *Atemp = intArray(n_samp);
-  double **Xtemp = doubleMatrix(n_samp+n_covC, n_covC+1);
+		int mda, int *A, double *refC){
+  int i;
+  double *w;
   
-  if (logitC) 
-    if (AT) 
-      logitMetro(C, Xc, betaC, n_samp, 2, n_covC, beta0, A0C, VarC, 1,
-		 acceptC); 
-    else 
-      logitMetro(C, Xc, betaC, n_samp, 1, n_covC, beta0, A0C, VarC, 1,
-		 acceptC);  
+  if (logitC && refC)
+    logitMetroSub(C, Dc, betaC, refC, AT ? 2 : 1, beta0, A0C, VarC, 1,
+		  acceptC);
+  else if (logitC) 
+    logitMetroCol(C, Dc, betaC, AT ? 2 : 1, beta0, A0C, VarC, 1,
+		  acceptC); 
   else {
     /* complier vs. noncomplier */
-    bprobitGibbs(C, Xc, betaC, n_samp, n_covC, 0, beta0, A0C,
-		 mda, 1);
+    bprobitGibbsCol(C, Dc, betaC, mda, 1);
     if (AT){
-      /* never-taker vs. always-taker */
-      /* subset the data */
-      itemp = 0;
-      for (i = 0; i < n_samp; i++)
-	if (C[i] == 0) {
-	  Atemp[itemp] = A[i];
-	  for (j = 0; j < n_covC; j++)
-	    Xtemp[itemp][j] = Xc[i][j];
-	  itemp++;
-	}
-      for (i = n_samp; i < n_samp + n_covC; i++) {
-	for (j = 0; j <= n_covC; j++)
-	  Xtemp[itemp][j] = Xc[i][j];
-	itemp++;
-      }
-      bprobitGibbs(Atemp, Xtemp, betaA, itemp-n_covC, n_covC, 0,
-		   beta0, A0C, mda, 1); 
+      /* never-taker vs. always-taker: the rows of the noncompliers
+	 have weight 1 */
+      w = doubleArray(Dc->n_samp);
+      for (i = 0; i < Dc->n_samp; i++)
+	w[i] = (C[i] == 0);
+      DesignWeights(DcA, w);
+      bprobitGibbsCol(A, DcA, betaA, mda, 1);
+      free(w);
     }      
   }
-  free(Atemp);
-  FreeMatrix(Xtemp, n_samp+n_covC);
 }
 
+/* 
+   The indicator columns for compliance types are the leading columns
+   T of the response design, which the view of the outcome design on
+   the units with observed Y (Dobs) shares; the cross-products of both
+   are updated.  If Dobs is NULL, the indicators are copied to the
+   rows with observed Y in Xobs instead
+*/
+
+void CompSync(int AT, colDesign *Dr, colDesign *Dobs, double **Xobs,
+	      int *R){
+  int i, j, itemp, n_samp = Dr->n_samp;
+  int n_col = AT ? 3 : 2;
+  double *t;
+
+  for (j = 0; j < n_col; j++) {
+    DesignColumn(Dr, j);
+    if (Dobs) {
+      DesignColumn(Dobs, j);
+      continue;
+    }
+    t = Dr->T + (size_t)j*n_samp;
+    itemp = 0;
+    for (i = 0; i < n_samp; i++)
+      if (R[i] == 1)
+	Xobs[itemp++][j] = t[i];
+  }
+}
+
+
 /* 
    Sampling Compliance Status 
 */
 
-void SampleComp(int n_samp, int n_covC,	int AT,	double **Xc,
-		double **Xo, double **Xr, double **Xobs, double *betaC,
-		double *betaA, int logitC, double *qC, double *qN,
-		int *Z,	int *D,	int *R,	int *RD, int *C, int *A,
-		double *pC, double *pN,	double *pA, double *prA,
-		double *prN, double *prC){
+void SampleComp(int AT, colDesign *Dc, colDesign *Dr, colDesign *Dobs,
+		double **Xobs, double *betaC, double *betaA, int logitC,
+		double *qC, double *qN, int *Z, int *D, int *R, int *RD,
+		int *C, int *A, double *pC, double *pN, double *pA,
+		double *prA, double *prN, double *prC){
 
-  int i, j, itemp;
+  int i, n_samp = Dc->n_samp, n_covC = Dc->n_cov;
   double dtemp, dtemp1 , dtemp2;
+  /* indicator columns for compliance types */
+  double *T[3];
   /* mean vector for the compliance model */
   double *meanc = doubleArray(n_samp);
   double *meana = doubleArray(n_samp);
 
-  itemp = 0;
+  T[0] = Dr->T; T[1] = T[0] + n_samp; T[2] = T[1] + n_samp;
+  DesignXBeta(Dc, 0, n_covC, betaC, meanc);
+  if (AT)
+    DesignXBeta(Dc, 0, n_covC, logitC ? betaC + n_covC : betaA, meana);
   for (i = 0; i < n_samp; i++) {
-    meanc[i] = 0;
-    for (j = 0; j < n_covC; j++) 
-      meanc[i] += Xc[i][j]*betaC[j];
     if (AT) { /* some always-takers */
-      meana[i] = 0;
       if (logitC) { /* if logistic regression is used */
-	for (j = 0; j < n_covC; j++) 
-	  meana[i] += Xc[i][j]*betaC[j+n_covC];
 	qC[i] = exp(meanc[i])/(1 + exp(meanc[i]) + exp(meana[i]));
 	qN[i] = 1/(1 + exp(meanc[i]) + exp(meana[i]));
       } else { /* double probit regressions */
-	for (j = 0; j < n_covC; j++) 
-	  meana[i] += Xc[i][j]*betaA[j];
 	qC[i] = pnorm(meanc[i], 0, 1, 1, 0);
 	qN[i] = (1-qC[i])*pnorm(meana[i], 0, 1, 0, 0);
       }
@@ -303,23 +340,23 @@ void SampleComp(int n_samp, int n_covC,	int AT,	double **Xc,
 	dtemp2 = unif_rand();
 	if (dtemp2 < dtemp) {
 	  C[i] = 1; A[i] = 0; D[i] = Z[i];
-	  Xo[i][1-Z[i]] = 1; Xr[i][1-Z[i]] = 1;
-	  Xo[i][Z[i]] = 0; Xr[i][Z[i]] = 0;
-	  Xo[i][2] = 0; Xr[i][2] = 0;
+	  T[1-Z[i]][i] = 1;
+	  T[Z[i]][i] = 0;
+	  T[2][i] = 0;
 	} else if (dtemp2 < dtemp1) {
 	  C[i] = 0; A[i] = 0; D[i] = 0; 
-	  Xo[i][0] = 0; Xr[i][0] = 0;
-	  Xo[i][1] = 0; Xr[i][1] = 0;
-	  Xo[i][2] = 0; Xr[i][2] = 0;
+	  T[0][i] = 0;
+	  T[1][i] = 0;
+	  T[2][i] = 0;
 	}  else {
 	  if (logitC)
 	    C[i] = 2; 
 	  else
 	    C[i] = 0;
 	  A[i] = 1; D[i] = 1; 
-	  Xo[i][0] = 0; Xr[i][0] = 0;
-	  Xo[i][1] = 0; Xr[i][1] = 0;
-	  Xo[i][2] = 1; Xr[i][2] = 1;
+	  T[0][i] = 0;
+	  T[1][i] = 0;
+	  T[2][i] = 1;
 	}
       } else if ((Z[i] == 0) && (D[i] == 0)){
 	if (R[i] == 1)
@@ -328,9 +365,9 @@ void SampleComp(int n_samp, int n_covC,	int AT,	double **Xc,
 	else 
 	  dtemp = qC[i]*prC[i]/(qC[i]*prC[i]+qN[i]*prN[i]);
 	if (unif_rand() < dtemp) {
-	  C[i] = 1; Xo[i][1] = 1; Xr[i][1] = 1;
+	  C[i] = 1; T[1][i] = 1;
 	} else {
-	  C[i] = 0; Xo[i][1] = 0; Xr[i][1] = 0;
+	  C[i] = 0; T[1][i] = 0;
 	}  
       } else if ((Z[i] == 1) && (D[i] == 1)){
 	if (R[i] == 1)
@@ -339,21 +376,16 @@ void SampleComp(int n_samp, int n_covC,	int AT,	double **Xc,
 	else
 	  dtemp = qC[i]*prC[i]/(qC[i]*prC[i]+(1-qC[i]-qN[i])*prA[i]);
 	if (unif_rand() < dtemp) {
-	  C[i] = 1; Xo[i][0] = 1; Xr[i][0] = 1;
-	  A[i] = 0; Xo[i][2] = 0; Xr[i][2] = 0;
+	  C[i] = 1; T[0][i] = 1;
+	  A[i] = 0; T[2][i] = 0;
 	} else {
 	  if (logitC)
 	    C[i] = 2;
 	  else
 	    C[i] = 0; 
-	  A[i] = 1; Xo[i][0] = 0; Xr[i][0] = 0; Xo[i][2] = 1; Xr[i][2] = 1;
+	  A[i] = 1; T[0][i] = 0; T[2][i] = 1;
 	}  
       }
-      if (R[i] == 1) {
-	Xobs[itemp][0] = Xo[i][0];
-	Xobs[itemp][1] = Xo[i][1];
-	Xobs[itemp][2] = Xo[i][2];
-      }
     } else { /* no always-takers */
       if ((Z[i] == 0) || (RD[i] == 0)) {
 	if (logitC)
@@ -367,31 +399,487 @@ void SampleComp(int n_samp, int n_covC,	int AT,	double **Xc,
 	  dtemp = qC[i]*prC[i]/(qC[i]*prC[i]+(1-qC[i])*prN[i]);
 	if (unif_rand() < dtemp) {
 	  C[i] = 1; D[i] = Z[i];
-	  Xo[i][1-Z[i]] = 1; Xr[i][1-Z[i]] = 1; 
-	  Xo[i][Z[i]] = 0; Xr[i][Z[i]] = 0; 
+	  T[1-Z[i]][i] = 1;
+	  T[Z[i]][i] = 0;
 	} else {
 	  C[i] = 0; D[i] = 0;
-	  Xo[i][0] = 0; Xr[i][0] = 0;
-	  Xo[i][1] = 0; Xr[i][1] = 0;
+	  T[0][i] = 0;
+	  T[1][i] = 0;
 	}
       }
-      if (R[i] == 1) {
-	Xobs[itemp][0] = Xo[i][0]; 
-	Xobs[itemp][1] = Xo[i][1]; 
-      }
     }
-    if (R[i] == 1) itemp++;
   }
+  CompSync(AT, Dr, Dobs, Xobs, R);
   
   free(meanc);  
   free(meana);
 }
 
 
+/* 
+   Warm start: the method-of-moments estimates of Noncomp.mom give
+   the type shares and, for each type, the response rate and the mean
+   (and, for a normal outcome, the pooled sd) of the observed outcome.
+   The initial types are drawn from the posterior type probabilities
+   they imply, and pC, pN and pA are set for the first draw of the
+   types in the sampler.  WarmCoef then starts the compliance and
+   response models at their posterior modes given these types.
+*/
+
+#define WARM_MIN 0.01   /* bounds of the moment estimates in (0,1) */
+#define WARM_ITER 10    /* # of Fisher scoring iterations */
+
+static double WarmClamp(double p){
+  return fmin2(fmax2(p, WARM_MIN), 1-WARM_MIN);
+}
+
+/* response rate and outcome mean of the compliers in a cell that
+   mixes them (share pc) with another type (share po) whose response
+   rate ro and outcome mean mo are known */
+static void WarmMix(double pc, double po, double Rcell, double Ycell,
+		    double ro, double mo, double *rc, double *mc){
+  double dtemp = (pc+po)*Rcell - po*ro;
+
+  *rc = WarmClamp(dtemp/pc);
+  if (dtemp > WARM_MIN*pc)
+    *mc = ((pc+po)*Rcell*Ycell - po*ro*mo)/dtemp;
+  else
+    *mc = Ycell;
+}
+
+static double WarmDens(int gaussian, double y, double m, double sd){
+  if (gaussian)
+    return dnorm(y, m, sd, 0);
+  return y*m + (1-y)*(1-m);
+}
+
+/* rule out the types inconsistent with the observed D */
+static void WarmMask(int Z, int D, double *w){
+  if (Z == D)   /* compliers or never-/always-takers */
+    w[Z ? 1 : 2] = 0;
+  else          /* always-/never-takers */
+    w[0] = w[Z ? 2 : 1] = 0;
+}
+
+void WarmTypes(int gaussian, int AT, int logitC, double *Y, int *R,
+	       int *Z, int *D, int *RD, int *C, int *A, colDesign *Dr,
+	       colDesign *Dobs, double **Xobs, double *pC, double *pN,
+	       double *pA){
+  int i, j, k, n_samp = Dr->n_samp;
+  int n_col = AT ? 3 : 2;
+  /* indicator columns for compliance types */
+  double *T = Dr->T;
+  /* cells 2*Z+D of the units with observed D */
+  double n[4], nr[4], sy[4], syy[4], Rk[4], Yk[4];
+  /* types: compliers under Z = 0 and 1, never-takers, always-takers */
+  double r[4], m[4], share[3], w[3];
+  double pc, pn, pa, ybar, sd, dtemp, dtemp1;
+
+  for (k = 0; k < 4; k++) {
+    n[k] = 0; nr[k] = 0; sy[k] = 0; syy[k] = 0;
+  }
+  for (i = 0; i < n_samp; i++)
+    if (RD[i] == 1) {
+      k = 2*Z[i]+D[i];
+      n[k]++;
+      if (R[i] == 1) {
+	nr[k]++; sy[k] += Y[i]; syy[k] += Y[i]*Y[i];
+      }
+    }
+  if (n[0]+n[1] == 0 || n[2]+n[3] == 0)
+    error("WarmTypes: each arm needs units with observed D.\n");
+
+  dtemp = 0; dtemp1 = 0; ybar = 0; sd = 0;
+  for (k = 0; k < 4; k++) {
+    dtemp += sy[k]; dtemp1 += nr[k];
+    if (nr[k] > 0)
+      sd += syy[k] - sy[k]*sy[k]/nr[k];
+  }
+  if (dtemp1 > 0) {
+    ybar = dtemp/dtemp1;
+    sd = sqrt(sd/dtemp1);
+  }
+  if (!(sd > 0))
+    sd = 1;
+  for (k = 0; k < 4; k++) {
+    Rk[k] = n[k] > 0 ? nr[k]/n[k] : 0.5;
+    Yk[k] = nr[k] > 0 ? sy[k]/nr[k] : ybar;
+  }
+
+  /* type shares */
+  pa = AT ? n[1]/(n[0]+n[1]) : 0;
+  pn = n[2]/(n[2]+n[3]);
+  pc = fmax2(1-pa-pn, WARM_MIN);
+  dtemp = pc+pn+pa;
+  pc /= dtemp; pn /= dtemp; pa /= dtemp;
+
+  /* never-takers and always-takers from their pure cells,
+     compliers by deconvolving the mixed cells */
+  r[2] = WarmClamp(Rk[2]); m[2] = Yk[2];
+  r[3] = WarmClamp(Rk[1]); m[3] = Yk[1];
+  WarmMix(pc, pn, Rk[0], Yk[0], r[2], m[2], &r[0], &m[0]);
+  if (AT)
+    WarmMix(pc, pa, Rk[3], Yk[3], r[3], m[3], &r[1], &m[1]);
+  else {
+    r[1] = WarmClamp(Rk[3]); m[1] = Yk[3];
+  }
+  if (!gaussian)
+    for (k = 0; k < 4; k++)
+      m[k] = WarmClamp(m[k]);
+
+  /* draw the types */
+  share[0] = pc; share[1] = pn; share[2] = pa;
+  for (i = 0; i < n_samp; i++) {
+    for (k = 0; k < 3; k++) {
+      j = (k == 0) ? Z[i] : k+1;
+      w[k] = share[k];
+      if (R[i] == 1)
+	w[k] *= r[j]*WarmDens(gaussian, Y[i], m[j], sd);
+      else
+	w[k] *= 1-r[j];
+    }
+    if (RD[i] == 1)
+      WarmMask(Z[i], D[i], w);
+    dtemp = w[0]+w[1]+w[2];
+    if (!(dtemp > 0)) { /* the densities underflowed */
+      for (k = 0; k < 3; k++)
+	w[k] = share[k];
+      if (RD[i] == 1)
+	WarmMask(Z[i], D[i], w);
+      dtemp = w[0]+w[1]+w[2];
+    }
+    dtemp1 = unif_rand()*dtemp;
+    for (j = 0; j < n_col; j++)
+      T[i+(size_t)j*n_samp] = 0;
+    if (dtemp1 < w[0]) {
+      C[i] = 1; A[i] = 0; D[i] = Z[i];
+      T[i+(size_t)(1-Z[i])*n_samp] = 1;
+    } else if (dtemp1 < w[0]+w[1] || !AT) {
+      C[i] = 0; A[i] = 0; D[i] = 0;
+    } else {
+      C[i] = logitC ? 2 : 0; A[i] = 1; D[i] = 1;
+      T[i+(size_t)2*n_samp] = 1;
+    }
+    if (R[i] == 1) {
+      pC[i] = WarmDens(gaussian, Y[i], m[Z[i]], sd);
+      pN[i] = WarmDens(gaussian, Y[i], m[2], sd);
+      if (AT)
+	pA[i] = WarmDens(gaussian, Y[i], m[3], sd);
+    }
+  }
+  CompSync(AT, Dr, Dobs, Xobs, R);
+}
+
+void WarmCoef(int logitC, int logitR, int AT, int *C, int *A, int *R,
+	      colDesign *Dc, colDesign *Dr, double *betaC, double *betaA,
+	      double *delta, int n_miss, double *beta0, double *delta0,
+	      double **A0C, double **A0R){
+  int i, j, k, n_samp = Dc->n_samp, n_covC = Dc->n_cov;
+  int *use = intArray(n_samp);
+  double **A0 = doubleMatrix(n_covC, n_covC);
+
+  if (logitC && AT) {
+    /* compliers and always-takers, each against the never-takers */
+    for (i = 0; i < n_samp; i++)
+      use[i] = (C[i] != 2);
+    bGLMMode(C, Dc, betaC, 1, use, 1, beta0, A0C, WARM_ITER);
+    for (i = 0; i < n_samp; i++)
+      use[i] = (C[i] != 1);
+    for (j = 0; j < n_covC; j++)
+      for (k = 0; k < n_covC; k++)
+	A0[j][k] = A0C[n_covC+j][n_covC+k];
+    bGLMMode(C, Dc, betaC+n_covC, 2, use, 1, beta0+n_covC, A0, WARM_ITER);
+  } else {
+    bGLMMode(C, Dc, betaC, 1, NULL, logitC, beta0, A0C, WARM_ITER);
+    if (AT) { /* never-takers vs. always-takers */
+      for (i = 0; i < n_samp; i++)
+	use[i] = (C[i] == 0);
+      bGLMMode(A, Dc, betaA, 1, use, 0, beta0, A0C, WARM_ITER);
+    }
+  }
+  if (n_miss > 0)
+    bGLMMode(R, Dr, delta, 1, NULL, logitR, delta0, A0R, WARM_ITER);
+
+  free(use);
+  FreeMatrix(A0, n_covC);
+}
+
+
+/* 
+   Checkpoint of the state shared by the samplers below; each sampler
+   adds the parameters of its outcome model.  The indicators of the
+   compliance types are saved straight from their buffer T, and the
+   samplers call CompSync after a load
+*/
+
+ckptState *CkptComp(char *file, int n_samp, int n_covC, int n_covO,
+		    int n_covR, int n_gen, int burnin, int iKeep,
+		    int AT, int logitC, int param, int *C, int *A,
+		    int *D, double *betaC, double *betaA, double *delta,
+		    int *acceptC, int *acceptR, double *pC, double *pN,
+		    double *pA, double *prC, double *prN, double *prA,
+		    double *T, int *n_done, int *keep, int *progress,
+		    int *itempP, drawSink *sink){
+  int dims[10];
+  ckptState *ck;
+
+  if (!sink || sink->summary)
+    error("checkpoints require the draws to be streamed to a file.\n");
+
+  ck = CkptOpen(file);
+  dims[0] = n_samp; dims[1] = n_covC; dims[2] = n_covO; 
+  dims[3] = n_covR; dims[4] = n_gen; dims[5] = burnin; 
+  dims[6] = iKeep; dims[7] = AT; dims[8] = logitC; dims[9] = param;
+  CkptConst(ck, "dims", dims, 10);
+  CkptInt(ck, "n_done", n_done, 1);
+  CkptInt(ck, "keep", keep, 1);
+  CkptInt(ck, "progress", progress, 1);
+  CkptInt(ck, "itempP", itempP, 1);
+  CkptInt(ck, "n_rec", &(sink->n_rec), 1);
+  CkptInt(ck, "C", C, n_samp);
+  CkptInt(ck, "A", A, n_samp);
+  CkptInt(ck, "D", D, n_samp);
+  CkptDouble(ck, "comp", T, n_samp*(AT ? 3 : 2));
+  CkptDouble(ck, "betaC", betaC, (logitC && AT) ? 2*n_covC : n_covC);
+  CkptDouble(ck, "betaA", betaA, n_covC);
+  CkptDouble(ck, "delta", delta, n_covR);
+  CkptInt(ck, "acceptC", acceptC, 2*n_covC);
+  CkptInt(ck, "acceptR", acceptR, n_covR);
+  CkptDouble(ck, "pC", pC, n_samp);
+  CkptDouble(ck, "pN", pN, n_samp);
+  CkptDouble(ck, "pA", pA, n_samp);
+  CkptDouble(ck, "prC", prC, n_samp);
+  CkptDouble(ck, "prN", prN, n_samp);
+  CkptDouble(ck, "prA", prA, n_samp);
+  return ck;
+}
+
+
+/* 
+   Mean outcome given the linear predictor(s) of the outcome model
+*/
+
+static double PopMean(int link, double eta, double eta1, double sig2){
+  switch (link) {
+  case QOI_LOGIT:
+    return 1/(1+exp(-eta));
+  case QOI_PROBIT:
+    return pnorm(eta, 0, 1, 1, 0);
+  case QOI_GAUSSIAN:
+    return eta;
+  case QOI_NEGBIN:
+    return exp(eta);
+  default: /* two-part: Pr(Y > 0) times E(Y | Y > 0) */
+    return exp(eta1+0.5*sig2)*pnorm(eta, 0, 1, 1, 0);
+  }
+}
+
+
+/* 
+   Population QoI: sums of the mean outcomes over the units in one
+   pass over the linear predictors computed for the probabilities of
+   Y (meano, and meano1 for the two-part model); the units are split
+   among n_thread threads
+*/
+
+void PopQoI(int link, int n_samp, int AT, double *meano,
+	    double *gamma, double *meano1, double *gamma1, double sig2,
+	    double *qC, int n_thread, double *Y1barC, double *Y0barC,
+	    double *YbarN, double *YbarA, double *ITT){
+  int i;
+  double y1 = 0, y0 = 0, yn = 0, ya = 0, itt = 0;
+  double m1, m0;
+  double g0 = gamma[0], g1 = gamma[1], g2 = AT ? gamma[2] : 0;
+  double h0 = 0, h1 = 0, h2 = 0;
+
+  if (link == QOI_TWOPART) {
+    h0 = gamma1[0]; h1 = gamma1[1]; h2 = AT ? gamma1[2] : 0;
+  } else
+    meano1 = meano; 
+
+#ifdef _OPENMP
+#pragma omp parallel for private(m1, m0) reduction(+:y1, y0, yn, ya, itt) \
+  num_threads(n_thread > 1 ? n_thread : 1) if (n_thread > 1)
+#endif
+  for (i = 0; i < n_samp; i++) {
+    /* compliers */
+    m1 = PopMean(link, meano[i]+g0, meano1[i]+h0, sig2);
+    m0 = PopMean(link, meano[i]+g1, meano1[i]+h1, sig2);
+    y1 += m1; y0 += m0;
+    itt += (m1-m0)*qC[i];
+    /* never-takers */
+    yn += PopMean(link, meano[i], meano1[i], sig2);
+    /* always-takers */
+    if (AT)
+      ya += PopMean(link, meano[i]+g2, meano1[i]+h2, sig2);
+  }
+  *Y1barC = y1; *Y0barC = y0; *YbarN = yn; *YbarA = ya; *ITT = itt;
+}
+
+
+/* 
+   Rao-Blackwellized in-sample QoI: the sampled types and missing
+   outcomes are replaced by their conditional expectations given the
+   current parameters and the observed data.  The type probabilities
+   are those from which SampleComp draws the types, and the means of
+   the missing outcomes those of PopMean.  The observed outcome is Yi
+   or Yd, whichever is not NULL.  The sums are returned as in PopQoI,
+   and n_type gets the expected # of compliers, never-takers and
+   always-takers.
+*/
+
+void InsampleRB(int link, int n_samp, int AT, int *Yi, double *Yd,
+		int *R, int *Z, int *D, int *RD, double *meano,
+		double *gamma, double *meano1, double *gamma1,
+		double sig2, double *qC, double *qN, double *pC,
+		double *pN, double *pA, double *prC, double *prN,
+		double *prA, double *Y1barC, double *Y0barC,
+		double *YbarN, double *YbarA, double *n_type){
+  int i;
+  double w[3], y, m1, m0, dtemp;
+  double g2 = AT ? gamma[2] : 0, h0 = 0, h1 = 0, h2 = 0;
+
+  if (link == QOI_TWOPART) {
+    h0 = gamma1[0]; h1 = gamma1[1]; h2 = AT ? gamma1[2] : 0;
+  } else
+    meano1 = meano;
+
+  *Y1barC = 0; *Y0barC = 0; *YbarN = 0; *YbarA = 0;
+  n_type[0] = 0; n_type[1] = 0; n_type[2] = 0;
+  for (i = 0; i < n_samp; i++) {
+    /* type probabilities */
+    if (AT) {
+      w[0] = qC[i]; w[1] = qN[i]; w[2] = 1-qC[i]-qN[i];
+      if (RD[i] == 1) {
+	if (Z[i] == D[i])
+	  w[Z[i] ? 1 : 2] = 0;
+	else { /* never-takers and always-takers */
+	  w[0] = 0; w[1] = Z[i]; w[2] = 1-Z[i];
+	}
+      }
+    } else if ((Z[i] == 0) || (RD[i] == 0)) {
+      w[0] = qC[i]; w[1] = 1-qC[i]; w[2] = 0;
+    } else {
+      w[0] = D[i]; w[1] = 1-D[i]; w[2] = 0;
+    }
+    m1 = w[0]*prC[i]; m0 = w[1]*prN[i]; dtemp = w[2]*prA[i];
+    if (R[i] == 1) {
+      m1 *= pC[i]; m0 *= pN[i]; dtemp *= pA[i];
+    }
+    if (m1+m0+dtemp > 0) {
+      w[0] = m1; w[1] = m0; w[2] = dtemp;
+    }
+    dtemp = w[0]+w[1]+w[2];
+    w[0] /= dtemp; w[1] /= dtemp; w[2] /= dtemp;
+    n_type[0] += w[0]; n_type[1] += w[1]; n_type[2] += w[2];
+
+    /* expected outcomes */
+    y = 0;
+    if (R[i] == 1)
+      y = Yi ? (double)Yi[i] : Yd[i];
+    m1 = PopMean(link, meano[i]+gamma[0], meano1[i]+h0, sig2);
+    m0 = PopMean(link, meano[i]+gamma[1], meano1[i]+h1, sig2);
+    if (R[i] == 1) {
+      if (Z[i] == 1)
+	m1 = y;
+      else
+	m0 = y;
+    }
+    *Y1barC += w[0]*m1; *Y0barC += w[0]*m0;
+    if (w[1] > 0)
+      *YbarN += w[1]*(R[i] == 1 ? y : 
+		      PopMean(link, meano[i], meano1[i], sig2));
+    if (w[2] > 0)
+      *YbarA += w[2]*(R[i] == 1 ? y :
+		      PopMean(link, meano[i]+g2, meano1[i]+h2, sig2));
+  }
+}
+
+
+/* 
+   Population QoI for the ordered probit model; the normal CDF is
+   evaluated once per cutpoint and type, and the sums for each
+   category j = 1, ..., n_cat-1 are accumulated by each thread
+   separately
+*/
+
+void PopQoIordinal(int n_samp, int n_cat, int AT, double *meano,
+		   double *gamma, double *tau, double *qC, int n_thread,
+		   double *Y1barC, double *Y0barC, double *YbarN,
+		   double *YbarA, double *ITT){
+  int j, n_type = AT ? 4 : 3, n_th = n_thread > 1 ? n_thread : 1;
+  /* scratch of each thread, allocated here since error() must not be
+     raised inside the parallel region */
+  double *work = doubleArray(n_th*13*n_cat);
+
+  for (j = 0; j < n_cat-1; j++) {
+    Y1barC[j] = 0; Y0barC[j] = 0; YbarN[j] = 0; YbarA[j] = 0; ITT[j] = 0;
+  }
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(n_th) if (n_th > 1)
+#endif
+  {
+    int i, j, k, t;
+    double shift[4];
+    /* CDF at each cutpoint and Pr(Y = j) for each type, and the sums:
+       type t at [t*n_cat] */
+#ifdef _OPENMP
+    double *cdf = work + (size_t)omp_get_thread_num()*13*n_cat;
+#else
+    double *cdf = work;
+#endif
+    double *prob = cdf + 4*n_cat, *sum = prob + 4*n_cat;
+
+    shift[0] = gamma[0]; shift[1] = gamma[1]; shift[2] = 0;
+    shift[3] = AT ? gamma[2] : 0;
+    for (t = 0; t < 5; t++)
+      for (j = 0; j < n_cat-1; j++)
+	sum[t*n_cat+j] = 0;
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+    for (i = 0; i < n_samp; i++) {
+      for (t = 0; t < n_type; t++) {
+	for (k = 0; k < n_cat-1; k++)
+	  cdf[t*n_cat+k] = pnorm(tau[k], meano[i]+shift[t], 1, 1, 0);
+	for (j = 1; j < n_cat-1; j++)
+	  prob[t*n_cat+j-1] = cdf[t*n_cat+j]-cdf[t*n_cat+j-1];
+	prob[t*n_cat+n_cat-2] = pnorm(tau[n_cat-2], meano[i]+shift[t], 1, 0, 0);
+      }
+      for (j = 0; j < n_cat-1; j++) {
+	sum[j] += prob[j];
+	sum[n_cat+j] += prob[n_cat+j];
+	sum[2*n_cat+j] += prob[2*n_cat+j];
+	if (AT)
+	  sum[3*n_cat+j] += prob[3*n_cat+j];
+	sum[4*n_cat+j] += (prob[j]-prob[n_cat+j])*qC[i];
+      }
+    }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+    for (j = 0; j < n_cat-1; j++) {
+      Y1barC[j] += sum[j]; Y0barC[j] += sum[n_cat+j];
+      YbarN[j] += sum[2*n_cat+j]; YbarA[j] += sum[3*n_cat+j];
+      ITT[j] += sum[4*n_cat+j];
+    }
+  }
+
+  free(work);
+}
+
+
 /* 
    Binary outcomes (logit and probit)
 */
 
+#define SUB_WARMUP 50   /* # of iterations over which the reference
+			   points follow the draws, even without a
+			   burnin */
+
 void LIbinary(int *Y,         /* binary outcome variable */ 
 	      int *R,         /* recording indicator for Y */
 	      int *Z,         /* treatment assignment */
@@ -409,8 +897,10 @@ void LIbinary(int *Y,         /* binary outcome variable */
 	      int *AT,        /* Are there always-takers? */
 	      int *Insample,  /* Insample (=1) or population QoI? */
 	      double *dXc,    /* model matrix for compliance model */
-	      double *dXo,    /* model matrix for outcome model */
-	      double *dXr,    /* model matrix for response model */
+	      double *dXo,    /* model matrix for outcome model,
+	                       without the indicators of the
+	                       compliance types */
+	      double *dXr,    /* model matrix for response model, likewise */
 	      double *betaC,  /* coefficients for compliance model */
 	      double *betaA,  /* coefficients for always-takers model */
 	      double *gamma,  /* coefficients for outcome model */
@@ -442,6 +932,36 @@ void LIbinary(int *Y,         /* binary outcome variable */
 	      int *burnin,   /* number of burnin */
 	      int *iKeep,     /* keep ?th draws */
 	      int *verbose,   /* print out messages */
+	      char **outfile, /* file to which kept draws are streamed;
+				 "" keeps them in the storage below */
+	      int *online,    /* summarize kept draws instead of
+				 storing them? */
+	      char **ckfile,  /* checkpoint file; "" for none */
+	      int *ckevery,   /* write a checkpoint every ?th iteration */
+	      int *resume,    /* resume the chain from the checkpoint? */
+	      int *nthread,   /* # of threads for the population QoI */
+	      int *subsample, /* evaluate a random subset of the units
+				 in each Metropolis move of the logistic
+				 regressions? */
+	      int *warm,      /* start from the method-of-moments
+				 estimates? */
+	      int *rb,        /* Rao-Blackwellize the insample QoI? */
+	      double *ess,    /* stop once the effective sample size of
+	      			 each QoI is ess or more; 0 for never */
+	      double *rhat,   /* and its split R-hat is rhat or less */
+	      int *single,    /* keep a float copy of the covariates? */
+	      int *sparse,    /* covariates other than the compliance
+				 indicators passed as compressed sparse
+				 columns? */
+	      int *spc_p,     /* sparse covariates: column pointers, */
+	      int *spc_i,     /* row indices, */
+	      double *spc_x,  /* and values */
+	      int *spo_p,
+	      int *spo_i,
+	      double *spo_x,
+	      int *spr_p,
+	      int *spr_i,
+	      double *spr_x,
 	      double *coefC,  /* Storage for coefficients of the
 				 compliance model */
 	      double *coefA,  /* Storage for coefficients of the
@@ -450,7 +970,11 @@ void LIbinary(int *Y,         /* binary outcome variable */
 				 outcome model */
 	      double *coefR,  /* Storage for coefficients of the
 				 response model */	      
-	      double *QoI     /* Storage of quantities of interest */
+	      double *QoI,    /* Storage of quantities of interest */
+	      double *summary,/* Storage of the summaries of kept draws
+				 when online */
+	      double *profile,/* time spent in each phase and counters */
+	      double *conv    /* why and when the sampler stopped */
 	      ) {
   /** counters **/
   int n_samp = *in_samp;
@@ -461,16 +985,15 @@ void LIbinary(int *Y,         /* binary outcome variable */
   int n_obs = n_samp - n_miss;
 
   /*** data ***/
-  /*** observed Y ***/
-  int *Yobs = intArray(n_obs);
-  /* covariates for the compliance model */
-  double **Xc = doubleMatrix(n_samp+n_covC, n_covC+1);
-  /* covariates for the outcome model */
-  double **Xo = doubleMatrix(n_samp+n_covO, n_covO+1);    
-  /* covariates for the outcome model: only units with observed Y */     
-  double **Xobs = doubleMatrix(n_obs+n_covO, n_covO+1);    
-  /* covariates for the response model: includes all obs */     
-  double **Xr = doubleMatrix(n_samp+n_covR, n_covR+1);    
+  /* covariates for the compliance and response models, read in
+     place (see CompDesigns), and the indicators of the compliance
+     types */
+  colDesign *Dc, *DcA, *Dr;
+  double *T;
+  /* covariates for the outcome model, and its view of the units with
+     observed Y, whose rows have weight R */
+  colDesign *Do, *Dobs;
+  double *w = doubleArray(n_samp);
   /* mean vector for the outcome model */
   double *meano = doubleArray(n_samp);
 
@@ -498,6 +1021,7 @@ void LIbinary(int *Y,         /* binary outcome variable */
   int *n_comp = intArray(2);          /* number of compliers */
   int *n_never = intArray(2);
   int *n_always = intArray(2);
+  double n_type[3];  /* expected # of each type */
   double p_comp, p_never; /* prob. of being a particular type */
 
   /*** storage parameters and loop counters **/
@@ -508,57 +1032,157 @@ void LIbinary(int *Y,         /* binary outcome variable */
   int *acceptR = intArray(n_covR);      /* number of acceptance */
   int i, j, main_loop;
   int itempP = ftrunc((double) *n_gen/10);
-  int itemp, itempA, itempC, itempO, itempQ, itempR;
+  int itempA, itempC, itempO, itempQ, itempR;
   double dtemp, dtemp1;
+  drawSink *sink = NULL;   /* output sink for kept draws */
+  ckptState *ck = NULL;    /* checkpoint of the sampler */
+  convMonitor *mon = NULL; /* convergence monitor of the QoIs */
+  int stopped = 0;         /* have the convergence targets been met? */
+  int n_done = 0;          /* # of iterations already done */
+  /* reference points of the subsampling Metropolis moves; they
+     follow the draws during the burnin, or the first SUB_WARMUP
+     iterations if longer, and are then held fixed */
+  double *refC = NULL, *refO = NULL, *refR = NULL;
 
   /*** get random seed ***/
   GetRNGstate();
 
   /*** Preparing ***/
-  Prep(dXc, Xc, dXo, Xo, dXr, Xr, Xobs, R, n_samp, n_obs, n_covC,
-       n_covO, n_covR, *logitC, *AT, dA0C, A0C, dA0O, A0O, 1, dA0R, 
-       A0R, beta0, delta0, gamma0, pC, pN, pA, prC, prN, prA, acceptC,
-       acceptR, n_miss); 
-
-  /*** observed Y ***/
-  itemp = 0;
-  for (i = 0; i < n_samp; i++) 
-    if (R[i] == 1) 
-      Yobs[itemp++] = Y[i];
+  CompDesigns(dXc, dXr, C, Z, A, n_samp, n_covC, n_covR, *logitC,
+	      *logitR, *AT, n_miss, dA0C, dA0R, beta0, delta0, *single,
+	      *sparse, spc_p, spc_i, spc_x, spr_p, spr_i, spr_x, &T, &Dc,
+	      &DcA, &Dr);
+  Prep(dXo, T, NULL, R, n_samp, n_obs, n_covC, n_covO, n_covR, *logitC,
+       *AT, dA0C, A0C, dA0O, A0O, 1, dA0R, A0R, gamma0, pC, pN, pA,
+       prC, prN, prA, acceptC, acceptR);
+  Do = DesignOpen(dXo, n_samp, n_covO, *sparse ? (*AT ? 3 : 2) : n_covO,
+		  T, *AT ? 3 : 2, spo_p, spo_i, spo_x, NULL, NULL, NULL,
+		  *single);
+  for (i = 0; i < n_samp; i++)
+    w[i] = R[i];
+  Dobs = DesignView(Do, w, *logitO ? NULL : dA0O, gamma0);
   
   for (j = 0; j < n_covO; j++)
     acceptO[j] = 0;
 
+  /*** warm start ***/
+  if (*warm && !*resume) {
+    for (i = 0; i < n_samp; i++) /* meano is free until the loop */
+      meano[i] = Y[i];
+    WarmTypes(0, *AT, *logitC, meano, R, Z, D, RD, C, A, Dr, Dobs, NULL,
+	      pC, pN, pA);
+    WarmCoef(*logitC, *logitR, *AT, C, A, R, Dc, Dr, betaC, betaA, delta,
+	     n_miss, beta0, delta0, A0C, A0R);
+    bGLMMode(Y, Dobs, gamma, 1, R, *logitO, gamma0, A0O, WARM_ITER);
+  }
+
+  /*** summarize the kept draws or stream them to a file? ***/
+  if (*online)
+    sink = SinkSummary(summary);
+  else if (strlen(*outfile) > 0)
+    sink = SinkOpen(*outfile);
+  if (sink) {
+    QoI = SinkBlock(sink, "QoI", *AT ? 8 : 7);
+    if (*param) {
+      coefC = SinkBlock(sink, "coefC", n_covC);
+      if (*AT)
+	coefA = SinkBlock(sink, "coefA", n_covC);
+      coefO = SinkBlock(sink, "coefO", n_covO);
+      if (n_miss > 0)
+	coefR = SinkBlock(sink, "coefR", n_covR);
+    }
+  }
+
+  /*** subsampling Metropolis moves for the logistic regressions ***/
+  if (*subsample) {
+    if (*logitC)
+      refC = doubleArray(n_covC*2);
+    if (*logitO)
+      refO = doubleArray(n_covO);
+    if (*logitR && n_miss > 0)
+      refR = doubleArray(n_covR);
+  }
+
+  /*** checkpoint the sampler or resume it? ***/
+  if (strlen(*ckfile) > 0) {
+    ck = CkptComp(*ckfile, n_samp, n_covC, n_covO, n_covR, *n_gen, *burnin,
+		  *iKeep, *AT, *logitC, *param, C, A, D, betaC, betaA, delta,
+		  acceptC, acceptR, pC, pN, pA, prC, prN, prA, T, &n_done,
+		  &keep, &progress, &itempP, sink);
+    CkptDouble(ck, "gamma", gamma, n_covO);
+    CkptInt(ck, "acceptO", acceptO, n_covO);
+    if (refC)
+      CkptDouble(ck, "refC", refC, n_covC*(1+*AT));
+    if (refO)
+      CkptDouble(ck, "refO", refO, n_covO);
+    if (refR)
+      CkptDouble(ck, "refR", refR, n_covR);
+    if (*resume) {
+      CkptLoad(ck);
+      CompSync(*AT, Dr, Dobs, NULL, R);
+    }
+  } else if (*resume)
+    error("LIbinary: no checkpoint to resume from.\n");
+  if (sink) {
+    if (ck && *resume)
+      SinkResume(sink);
+    else
+      SinkStart(sink);
+  }
+
+  /*** stop early once the QoIs have converged? ***/
+  if (*ess > 0)
+    mon = MonOpen((*AT ? 8 : 7), *ess, *rhat);
+
   /*** Gibbs Sampler! ***/
+  ProfReset();
+  ProfAcceptStart(acceptC, n_covC*2);
+  ProfAcceptStart(acceptR, n_covR);
+  ProfAcceptStart(acceptO, n_covO);
   itempA = 0; itempC = 0; itempO = 0; itempQ = 0; itempR = 0;   
-  for (main_loop = 1; main_loop <= *n_gen; main_loop++){
+  for (main_loop = n_done+1; main_loop <= *n_gen && !stopped;
+       main_loop++){
+    if (main_loop <= imax2(*burnin, SUB_WARMUP)) {
+      for (j = 0; refC && j < n_covC*(1+*AT); j++)
+	refC[j] = betaC[j];
+      for (j = 0; refO && j < n_covO; j++)
+	refO[j] = gamma[j];
+      for (j = 0; refR && j < n_covR; j++)
+	refR[j] = delta[j];
+    }
 
     /* Step 1: RESPONSE MODEL */
-    if (n_miss > 0)
-      Response(*logitR, R, Xr, delta, n_samp, n_covR, delta0, A0R, VarR,
-	       acceptR, *mda, *AT, Z, D, prC, prN, prA);
+    if (n_miss > 0) {
+      ProfPhase(PROF_RESPONSE);
+      Response(*logitR, R, Dr, delta, delta0, A0R, VarR, acceptR,
+	       *mda, *AT, Z, D, prC, prN, prA, refR);
+    }
 
     /** Step 2: COMPLIANCE MODEL **/
-    Compliance(*logitC, *AT, C, Xc, betaC, n_samp, n_covC, beta0, A0C, 
-	       betaA, VarC, acceptC, *mda, A);
+    ProfPhase(PROF_COMPLIANCE);
+    Compliance(*logitC, *AT, C, Dc, DcA, betaC, beta0, A0C, betaA,
+	       VarC, acceptC, *mda, A, refC);
 
     /* Step 3: SAMPLE COMPLIANCE COVARITE */
-    SampleComp(n_samp, n_covC, *AT, Xc, Xo, Xr, Xobs, betaC, betaA,
-	       *logitC, qC, qN, Z, D, R, RD, C, A, pC, pN, pA, prA, prN, prC);
+    ProfPhase(PROF_LATENT);
+    SampleComp(*AT, Dc, Dr, Dobs, NULL, betaC, betaA, *logitC,
+	       qC, qN, Z, D, R, RD, C, A, pC, pN, pA, prA, prN, prC);
 
     /** Step 4: OUTCOME MODEL **/
-    if (*logitO)
-      logitMetro(Yobs, Xobs, gamma, n_obs, 1, n_covO, gamma0, A0O,
-		 VarO, 1, acceptO);
+    ProfPhase(PROF_OUTCOME);
+    if (*logitO && refO)
+      logitMetroSub(Y, Dobs, gamma, refO, 1, gamma0, A0O, VarO, 1,
+		    acceptO);
+    else if (*logitO)
+      logitMetroCol(Y, Dobs, gamma, 1, gamma0, A0O, VarO, 1, acceptO);
     else
-      bprobitGibbs(Yobs, Xobs, gamma, n_obs, n_covO, 0, gamma0, A0O, *mda, 1);
+      bprobitGibbsCol(Y, Dobs, gamma, *mda, 1);
 
     /** Compute probabilities of Y = Yobs **/
+    ProfPhase(PROF_PROB);
+    DesignXBeta(Do, *AT ? 3 : 2, n_covO, gamma, meano);
     for (i = 0; i < n_samp; i++) {
-      meano[i] = 0;
       if (*AT) { /* always-takers */
-	for (j = 3; j < n_covO; j++)
-	  meano[i] += Xo[i][j]*gamma[j];
 	if (R[i] == 1) {
 	  if ((RD[i] == 0) || (Z[i] == D[i])) {
 	    if (*logitO) {
@@ -576,8 +1200,6 @@ void LIbinary(int *Y,         /* binary outcome variable */
 	  } 
 	}
       } else { /* no always-takers */
-	for (j = 2; j < n_covO; j++)
-	  meano[i] += Xo[i][j]*gamma[j];
 	if (R[i] == 1)
 	  if ((Z[i] == 0) || (RD[i] == 0)) {
 	    if (*logitO) {
@@ -594,9 +1216,11 @@ void LIbinary(int *Y,         /* binary outcome variable */
     }
     
     /** storing the results **/
+    ProfPhase(PROF_STORE);
     if (main_loop > *burnin) {
       if (keep == *iKeep) {
 	/** Computing Quantities of Interest **/
+	ProfPhase(PROF_QOI);
 	n_comp[0] = 0; n_comp[1] = 0; 
 	n_never[0] = 0; n_never[1] = 0;
 	n_always[0] = 0; n_always[1] = 0;
@@ -620,7 +1244,7 @@ void LIbinary(int *Y,         /* binary outcome variable */
 	      else
 		n_never[0]++;
 	  }
-	  if (*Insample) { /* insample QoI */
+	  if (*Insample && !*rb) { /* insample QoI */
 	    if (C[i] == 1) {
 	      if (*logitO) {
 		dtemp = (double)(1/(1+exp(-meano[i]-gamma[0])) > unif_rand());
@@ -656,40 +1280,28 @@ void LIbinary(int *Y,         /* binary outcome variable */
 		  YbarN += (double)((meano[i]+norm_rand()) > 0);
 	      }
 	    } 
-	  } else { /* population QoI */
-	    /* compliers */
-	    if (*logitO) {
-	      dtemp = 1/(1+exp(-meano[i]-gamma[0]));
-	      dtemp1 = 1/(1+exp(-meano[i]-gamma[1])); 
-	    } else {
-	      dtemp = pnorm(meano[i]+gamma[0], 0, 1, 1, 0);
-	      dtemp1 = pnorm(meano[i]+gamma[1], 0, 1, 1, 0); 
-	    }
-	    Y1barC += dtemp; Y0barC += dtemp1;
-	    ITT += ((dtemp-dtemp1)*qC[i]);
-	    /* always-takers */
-	    if (*logitO)
-	      YbarA += 1/(1+exp(-meano[i]-gamma[2]));
-	    else
-	      YbarA += pnorm(meano[i]+gamma[2], 0, 1, 1, 0);
-	    /* never-takers */
-	    if (*logitO)
-	      YbarN += 1/(1+exp(-meano[i]));
-	    else
-	      YbarN += pnorm(meano[i], 0, 1, 1, 0);
 	  }
 	}
+	if (!*Insample) /* population QoI */
+	  PopQoI(*logitO ? QOI_LOGIT : QOI_PROBIT, n_samp, *AT, meano, gamma,
+		 NULL, NULL, 0, qC, *nthread, &Y1barC, &Y0barC, &YbarN,
+		 &YbarA, &ITT);
+	else if (*rb) /* Rao-Blackwellized insample QoI */
+	  InsampleRB(*logitO ? QOI_LOGIT : QOI_PROBIT, n_samp, *AT, Y, NULL,
+		     R, Z, D, RD, meano, gamma, NULL, NULL, 0, qC, qN, pC,
+		     pN, pA, prC, prN, prA, &Y1barC, &Y0barC, &YbarN,
+		     &YbarA, n_type);
 
 	p_comp /= (double)n_samp;  /* ITT effect on D; Prob. of being
 				      a complier */ 
 	p_never /= (double)n_samp; /* Prob. of being a never-taker */
 	if (*Insample) {
 	  ITT = (Y1barC-Y0barC)/(double)n_samp;     /* ITT effect */
-	  Y1barC /= (double)(n_comp[0]+n_comp[1]);  
-	  Y0barC /= (double)(n_comp[0]+n_comp[1]); 
-	  YbarN /= (double)(n_never[0]+n_never[1]);
+	  Y1barC /= *rb ? n_type[0] : (double)(n_comp[0]+n_comp[1]);
+	  Y0barC /= *rb ? n_type[0] : (double)(n_comp[0]+n_comp[1]);
+	  YbarN /= *rb ? n_type[1] : (double)(n_never[0]+n_never[1]);
 	  if (*AT)
-	    YbarA /= (double)(n_always[0]+n_always[1]);
+	    YbarA /= *rb ? n_type[2] : (double)(n_always[0]+n_always[1]);
 	} else {
 	  ITT /= (double)n_samp;     /* ITT effect */
 	  Y1barC /= (double)n_samp;
@@ -699,6 +1311,7 @@ void LIbinary(int *Y,         /* binary outcome variable */
 	    YbarA /= (double)n_samp;
 	}
 	CACE = Y1barC-Y0barC;    /* CACE */
+	ProfPhase(PROF_STORE);
 
 	QoI[itempQ++] = ITT;   
 	QoI[itempQ++] = CACE;   
@@ -709,6 +1322,8 @@ void LIbinary(int *Y,         /* binary outcome variable */
 	QoI[itempQ++] = YbarN;
 	if (*AT)
 	  QoI[itempQ++] = YbarA;
+	if (mon)
+	  stopped = MonAdd(mon, QoI + itempQ - (*AT ? 8 : 7));
 
 	if (*param) {
 	  for (j = 0; j < n_covC; j++)
@@ -728,6 +1343,10 @@ void LIbinary(int *Y,         /* binary outcome variable */
 	    for (j = 0; j < n_covR; j++)
 	      coefR[itempR++] = delta[j];
 	}
+	if (sink) { /* the storage holds the current draw only */
+	  SinkCommit(sink);
+	  itempA = 0; itempC = 0; itempO = 0; itempQ = 0; itempR = 0;
+	}
 	keep = 1;
       } else
 	keep++;
@@ -762,6 +1381,14 @@ void LIbinary(int *Y,         /* binary outcome variable */
 	R_FlushConsole(); 
       }
     }
+
+    /** checkpoint; the draws kept so far are written out first **/
+    if (ck && (main_loop % *ckevery == 0) && (main_loop < *n_gen)) {
+      n_done = main_loop;
+      SinkSync(sink);
+      CkptSave(ck);
+    }
+
     R_FlushConsole();
     R_CheckUserInterrupt();
   } /* end of Gibbs sampler */
@@ -769,12 +1396,37 @@ void LIbinary(int *Y,         /* binary outcome variable */
   /** write out the random seed **/
   PutRNGstate();
 
+  /** write out the profile **/
+  ProfAccept(acceptC, n_covC*2);
+  ProfAccept(acceptR, n_covR);
+  ProfAccept(acceptO, n_covO);
+  ProfWrite(profile);
+
+  /** write out the convergence status **/
+  if (mon) {
+    MonWrite(mon, stopped, main_loop-1, conv);
+    if (*verbose)
+      Rprintf("%s after %d iterations; smallest ESS %g, largest R-hat %g.\n",
+	      stopped ? "Converged" : "Not converged", main_loop-1,
+	      mon->min_ess, mon->max_rhat);
+    MonClose(mon);
+  }
+
+  /** close the output sink **/
+  if (sink)
+    SinkClose(sink);
+  if (ck)
+    CkptClose(ck);
+
   /** freeing memory **/
-  free(Yobs);
-  FreeMatrix(Xc, n_samp+n_covC);
-  FreeMatrix(Xo, n_samp+n_covO);
-  FreeMatrix(Xobs, n_obs+n_covO);
-  FreeMatrix(Xr, n_samp+n_covR);
+  DesignClose(Dc);
+  if (DcA)
+    DesignClose(DcA);
+  DesignClose(Dr);
+  DesignClose(Dobs);
+  DesignClose(Do);
+  free(T);
+  free(w);
   free(meano);
   free(pC);
   free(pN);
@@ -793,6 +1445,12 @@ void LIbinary(int *Y,         /* binary outcome variable */
   free(n_comp);
   free(n_never);
   free(n_always);
+  if (refC)
+    free(refC);
+  if (refO)
+    free(refO);
+  if (refR)
+    free(refR);
 
 } /* end of LIbinary */
 
@@ -818,8 +1476,10 @@ void LIgaussian(double *Y,      /* gaussian outcome variable */
 		int *AT,        /* Are there always-takers? */
 		int *Insample,  /* Insample (=1) or population QoI? */
 		double *dXc,    /* model matrix for compliance model */
-		double *dXo,    /* model matrix for outcome model */
-		double *dXr,    /* model matrix for response model */
+		double *dXo,    /* model matrix for outcome model,
+				   without the indicators of the
+				   compliance types */
+		double *dXr,    /* model matrix for response model, likewise */
 		double *betaC,  /* coefficients for compliance model */
 		double *betaA,  /* coefficients for always-takers model */
 		double *gamma,  /* coefficients for outcome model */
@@ -851,6 +1511,31 @@ void LIgaussian(double *Y,      /* gaussian outcome variable */
 		int *burnin,   /* number of burnin */
 		int *iKeep,     /* keep ?th draws */
 		int *verbose,   /* print out messages */
+		char **outfile, /* file to which kept draws are streamed;
+				   "" keeps them in the storage below */
+		char **ckfile,  /* checkpoint file; "" for none */
+		int *ckevery,   /* write a checkpoint every ?th iteration */
+		int *resume,    /* resume the chain from the checkpoint? */
+		int *nthread,   /* # of threads for the population QoI */
+		int *warm,      /* start from the method-of-moments
+				   estimates? */
+		int *rb,        /* Rao-Blackwellize the insample QoI? */
+		double *ess,    /* stop once the effective sample size of
+					 each QoI is ess or more; 0 for never */
+		double *rhat,   /* and its split R-hat is rhat or less */
+		int *single,    /* keep a float copy of the covariates? */
+		int *sparse,    /* covariates other than the compliance
+				   indicators passed as compressed sparse
+				   columns? */
+		int *spc_p,     /* sparse covariates: column pointers, */
+		int *spc_i,     /* row indices, */
+		double *spc_x,  /* and values */
+		int *spo_p,
+		int *spo_i,
+		double *spo_x,
+		int *spr_p,
+		int *spr_i,
+		double *spr_x,
 		double *coefC,  /* Storage for coefficients of the
 				   compliance model */
 		double *coefA,  /* Storage for coefficients of the
@@ -860,7 +1545,9 @@ void LIgaussian(double *Y,      /* gaussian outcome variable */
 		double *coefR,  /* Storage for coefficients of the
 				   response model */	      
 		double *var,    /* Storage for sig2 */
-		double *QoI     /* Storage of quantities of interest */
+		double *QoI,    /* Storage of quantities of interest */
+		double *profile,/* time spent in each phase and counters */
+		double *conv    /* why and when the sampler stopped */
 	      ) {
   /** counters **/
   int n_samp = *in_samp;
@@ -871,14 +1558,17 @@ void LIgaussian(double *Y,      /* gaussian outcome variable */
   int n_obs = n_samp - n_miss;
 
   /*** data ***/
-  /* covariates for the compliance model */
-  double **Xc = doubleMatrix(n_samp+n_covC, n_covC+1);
-  /* covariates for the outcome model */
-  double **Xo = doubleMatrix(n_samp+n_covO, n_covO+1);    
-  /* covariates for the outcome model: only units with observed Y */     
-  double **Xobs = doubleMatrix(n_obs+n_covO, n_covO+1);    
-  /* covariates for the response model: includes all obs */     
-  double **Xr = doubleMatrix(n_samp+n_covR, n_covR+1);    
+  /* covariates for the compliance and response models, read in
+     place (see CompDesigns), and the indicators of the compliance
+     types */
+  colDesign *Dc, *DcA, *Dr;
+  double *T;
+  /* covariates for the outcome model, and its view of the units with
+     observed Y, whose rows have weight R */
+  colDesign *Do, *Dobs;
+  double *w = doubleArray(n_samp);
+  /*** observed Y, and 0 for the units without ***/
+  double *Yobs = doubleArray(n_samp);
   /* mean vector for the outcome model */
   double *meano = doubleArray(n_samp);
 
@@ -906,6 +1596,7 @@ void LIgaussian(double *Y,      /* gaussian outcome variable */
   int *n_comp = intArray(2);          /* number of compliers */
   int *n_never = intArray(2);
   int *n_always = intArray(2);
+  double n_type[3];  /* expected # of each type */
   double p_comp, p_never; /* prob. of being a particular type */
 
   /*** storage parameters and loop counters **/
@@ -915,51 +1606,117 @@ void LIgaussian(double *Y,      /* gaussian outcome variable */
   int *acceptR = intArray(n_covR);      /* number of acceptance */
   int i, j, main_loop;
   int itempP = ftrunc((double) *n_gen/10);
-  int itemp, itempA, itempC, itempO, itempQ, itempR, itempS;
+  int itempA, itempC, itempO, itempQ, itempR, itempS;
   double dtemp, dtemp1;
+  drawSink *sink = NULL;   /* output sink for kept draws */
+  ckptState *ck = NULL;    /* checkpoint of the sampler */
+  convMonitor *mon = NULL; /* convergence monitor of the QoIs */
+  int stopped = 0;         /* have the convergence targets been met? */
+  int n_done = 0;          /* # of iterations already done */
 
   /*** get random seed **/
   GetRNGstate();
 
   /*** Preparing ***/
-  Prep(dXc, Xc, dXo, Xo, dXr, Xr, Xobs, R, n_samp, n_obs, n_covC,
-       n_covO, n_covR, *logitC, *AT, dA0C, A0C, dA0O, A0O, 1, dA0R, 
-       A0R, beta0, delta0, gamma0, pC, pN, pA, prC, prN, prA, acceptC,
-       acceptR, n_miss); 
+  CompDesigns(dXc, dXr, C, Z, A, n_samp, n_covC, n_covR, *logitC,
+	      *logitR, *AT, n_miss, dA0C, dA0R, beta0, delta0, *single,
+	      *sparse, spc_p, spc_i, spc_x, spr_p, spr_i, spr_x, &T, &Dc,
+	      &DcA, &Dr);
+  Prep(dXo, T, NULL, R, n_samp, n_obs, n_covC, n_covO, n_covR, *logitC,
+       *AT, dA0C, A0C, dA0O, A0O, 1, dA0R, A0R, gamma0, pC, pN, pA,
+       prC, prN, prA, acceptC, acceptR);
+  Do = DesignOpen(dXo, n_samp, n_covO, *sparse ? (*AT ? 3 : 2) : n_covO,
+		  T, *AT ? 3 : 2, spo_p, spo_i, spo_x, NULL, NULL, NULL,
+		  *single);
+  for (i = 0; i < n_samp; i++) {
+    w[i] = R[i];
+    Yobs[i] = R[i] ? Y[i] : 0;
+  }
+  Dobs = DesignView(Do, w, dA0O, gamma0);
+
+  /*** warm start ***/
+  if (*warm && !*resume) {
+    WarmTypes(1, *AT, *logitC, Y, R, Z, D, RD, C, A, Dr, Dobs, NULL,
+	      pC, pN, pA);
+    WarmCoef(*logitC, *logitR, *AT, C, A, R, Dc, Dr, betaC, betaA, delta,
+	     n_miss, beta0, delta0, A0C, A0R);
+    bNormalMode(Yobs, Dobs, gamma, sig2);
+  }
 
-  /*** observed Y ***/
-  itemp = 0;
-  for (i = 0; i < n_samp; i++) 
-    if (R[i] == 1) 
-      Xobs[itemp++][n_covO] = Y[i];
+  /*** stream the kept draws to a file? ***/
+  if (strlen(*outfile) > 0) {
+    sink = SinkOpen(*outfile);
+    QoI = SinkBlock(sink, "QoI", *AT ? 8 : 7);
+    if (*param) {
+      coefC = SinkBlock(sink, "coefC", n_covC);
+      if (*AT)
+	coefA = SinkBlock(sink, "coefA", n_covC);
+      coefO = SinkBlock(sink, "coefO", n_covO);
+      var = SinkBlock(sink, "sig2", 1);
+      if (n_miss > 0)
+	coefR = SinkBlock(sink, "coefR", n_covR);
+    }
+  }
+
+  /*** checkpoint the sampler or resume it? ***/
+  if (strlen(*ckfile) > 0) {
+    ck = CkptComp(*ckfile, n_samp, n_covC, n_covO, n_covR, *n_gen, *burnin,
+		  *iKeep, *AT, *logitC, *param, C, A, D, betaC, betaA, delta,
+		  acceptC, acceptR, pC, pN, pA, prC, prN, prA, T, &n_done,
+		  &keep, &progress, &itempP, sink);
+    CkptDouble(ck, "gamma", gamma, n_covO);
+    CkptDouble(ck, "sig2", sig2, 1);
+    if (*resume) {
+      CkptLoad(ck);
+      CompSync(*AT, Dr, Dobs, NULL, R);
+    }
+  } else if (*resume)
+    error("LIgaussian: no checkpoint to resume from.\n");
+  if (sink) {
+    if (ck && *resume)
+      SinkResume(sink);
+    else
+      SinkStart(sink);
+  }
+
+  /*** stop early once the QoIs have converged? ***/
+  if (*ess > 0)
+    mon = MonOpen((*AT ? 8 : 7), *ess, *rhat);
 
   /*** Gibbs Sampler! ***/
+  ProfReset();
+  ProfAcceptStart(acceptC, n_covC*2);
+  ProfAcceptStart(acceptR, n_covR);
   itempA = 0; itempC = 0; itempO = 0; itempQ = 0; itempR = 0; itempS = 0;
-  for (main_loop = 1; main_loop <= *n_gen; main_loop++){
+  for (main_loop = n_done+1; main_loop <= *n_gen && !stopped;
+       main_loop++){
 
     /* Step 1: RESPONSE MODEL */
-    if (n_miss > 0)
-      Response(*logitR, R, Xr, delta, n_samp, n_covR, delta0, A0R, VarR,
-	       acceptR, *mda, *AT, Z, D, prC, prN, prA);
+    if (n_miss > 0) {
+      ProfPhase(PROF_RESPONSE);
+      Response(*logitR, R, Dr, delta, delta0, A0R, VarR, acceptR,
+	       *mda, *AT, Z, D, prC, prN, prA, NULL);
+    }
 
     /** Step 2: COMPLIANCE MODEL **/
-    Compliance(*logitC, *AT, C, Xc, betaC, n_samp, n_covC, beta0, A0C, 
-	       betaA, VarC, acceptC, *mda, A);
+    ProfPhase(PROF_COMPLIANCE);
+    Compliance(*logitC, *AT, C, Dc, DcA, betaC, beta0, A0C, betaA,
+	       VarC, acceptC, *mda, A, NULL);
 
     /* Step 3: SAMPLE COMPLIANCE COVARITE */
-    SampleComp(n_samp, n_covC, *AT, Xc, Xo, Xr, Xobs, betaC, betaA,
-	       *logitC, qC, qN, Z, D, R, RD, C, A, pC, pN, pA, prA, prN, prC);
+    ProfPhase(PROF_LATENT);
+    SampleComp(*AT, Dc, Dr, Dobs, NULL, betaC, betaA, *logitC,
+	       qC, qN, Z, D, R, RD, C, A, pC, pN, pA, prA, prN, prC);
 
     /** Step 4: OUTCOME MODEL **/
-    bNormalReg(Xobs, gamma, sig2, n_obs, n_covO, 0, 1, gamma0, A0O, 1,
-	       *nu0, *s0, 0);
+    ProfPhase(PROF_OUTCOME);
+    bNormalRegCol(Yobs, Dobs, gamma, sig2, 1, 1, *nu0, *s0, 0);
 
     /** Compute probabilities of Y = Yobs **/
+    ProfPhase(PROF_PROB);
+    DesignXBeta(Do, *AT ? 3 : 2, n_covO, gamma, meano);
     for (i = 0; i < n_samp; i++) {
-      meano[i] = 0;
       if (*AT) { /* always-takers */
-	for (j = 3; j < n_covO; j++)
-	  meano[i] += Xo[i][j]*gamma[j];
 	if (R[i] == 1) {
 	  if ((RD[i] == 0) || (Z[i] == D[i])) {
 	    pC[i] = dnorm(Y[i], meano[i]+gamma[1-Z[i]], sqrt(*sig2), 0);
@@ -968,8 +1725,6 @@ void LIgaussian(double *Y,      /* gaussian outcome variable */
 	  } 
 	}
       } else { /* no always-takers */
-	for (j = 2; j < n_covO; j++)
-	  meano[i] += Xo[i][j]*gamma[j];
 	if (R[i] == 1)
 	  if ((Z[i] == 0) || (RD[i] == 0)){
 	    pC[i] = dnorm(Y[i], meano[i]+gamma[1-Z[i]], sqrt(*sig2), 0);
@@ -979,9 +1734,11 @@ void LIgaussian(double *Y,      /* gaussian outcome variable */
     }
     
     /** storing the results **/
+    ProfPhase(PROF_STORE);
     if (main_loop > *burnin) {
       if (keep == *iKeep) {
 	/** Computing Quantities of Interest **/
+	ProfPhase(PROF_QOI);
 	n_comp[0] = 0; n_comp[1] = 0; 
 	n_never[0] = 0; n_never[1] = 0;
 	n_always[0] = 0; n_always[1] = 0;
@@ -1005,7 +1762,7 @@ void LIgaussian(double *Y,      /* gaussian outcome variable */
 	      else
 		n_never[0]++;
 	  }
-	  if (*Insample) { /* insample QoI */
+	  if (*Insample && !*rb) { /* insample QoI */
 	    if (C[i] == 1) {
 	      dtemp = rnorm(meano[i]+gamma[0], sqrt(*sig2));
 	      dtemp1 = rnorm(meano[i]+gamma[1], sqrt(*sig2));
@@ -1028,29 +1785,26 @@ void LIgaussian(double *Y,      /* gaussian outcome variable */
 	      else 
 		YbarN += rnorm(meano[i], sqrt(*sig2));
 	    } 
-	  } else { /* population QoI */
-	    /* compliers */
-	    dtemp = (meano[i]+gamma[0]);
-	    dtemp1 = (meano[i]+gamma[1]); 
-	    Y1barC += dtemp; Y0barC += dtemp1;
-	    ITT += ((dtemp-dtemp1)*qC[i]);
-	    /* always-takers */
-	    YbarA += (meano[i]+gamma[2]);
-	    /* never-takers */
-	    YbarN += meano[i];
 	  }
 	}
+	if (!*Insample) /* population QoI */
+	  PopQoI(QOI_GAUSSIAN, n_samp, *AT, meano, gamma, NULL, NULL, 0, qC,
+		 *nthread, &Y1barC, &Y0barC, &YbarN, &YbarA, &ITT);
+	else if (*rb) /* Rao-Blackwellized insample QoI */
+	  InsampleRB(QOI_GAUSSIAN, n_samp, *AT, NULL, Y, R, Z, D, RD, meano,
+		     gamma, NULL, NULL, *sig2, qC, qN, pC, pN, pA, prC, prN,
+		     prA, &Y1barC, &Y0barC, &YbarN, &YbarA, n_type);
 
 	p_comp /= (double)n_samp;  /* ITT effect on D; Prob. of being
 				      a complier */ 
 	p_never /= (double)n_samp; /* Prob. of being a never-taker */
 	if (*Insample) {
 	  ITT = (Y1barC-Y0barC)/(double)n_samp;     /* ITT effect */
-	  Y1barC /= (double)(n_comp[0]+n_comp[1]);  
-	  Y0barC /= (double)(n_comp[0]+n_comp[1]); 
-	  YbarN /= (double)(n_never[0]+n_never[1]);
+	  Y1barC /= *rb ? n_type[0] : (double)(n_comp[0]+n_comp[1]);
+	  Y0barC /= *rb ? n_type[0] : (double)(n_comp[0]+n_comp[1]);
+	  YbarN /= *rb ? n_type[1] : (double)(n_never[0]+n_never[1]);
 	  if (*AT)
-	    YbarA /= (double)(n_always[0]+n_always[1]);
+	    YbarA /= *rb ? n_type[2] : (double)(n_always[0]+n_always[1]);
 	} else {
 	  ITT /= (double)n_samp;     /* ITT effect */
 	  Y1barC /= (double)n_samp;
@@ -1060,6 +1814,7 @@ void LIgaussian(double *Y,      /* gaussian outcome variable */
 	    YbarA /= (double)n_samp;
 	}
 	CACE = Y1barC-Y0barC;    /* CACE */
+	ProfPhase(PROF_STORE);
 
 	QoI[itempQ++] = ITT;   
 	QoI[itempQ++] = CACE;   
@@ -1070,6 +1825,8 @@ void LIgaussian(double *Y,      /* gaussian outcome variable */
 	QoI[itempQ++] = YbarN;
 	if (*AT)
 	  QoI[itempQ++] = YbarA;
+	if (mon)
+	  stopped = MonAdd(mon, QoI + itempQ - (*AT ? 8 : 7));
 
 	if (*param) {
 	  for (j = 0; j < n_covC; j++)
@@ -1090,6 +1847,10 @@ void LIgaussian(double *Y,      /* gaussian outcome variable */
 	    for (j = 0; j < n_covR; j++)
 	      coefR[itempR++] = delta[j];
 	}
+	if (sink) { /* the storage holds the current draw only */
+	  SinkCommit(sink);
+	  itempA = 0; itempC = 0; itempO = 0; itempQ = 0; itempR = 0; itempS = 0;
+	}
 	keep = 1;
       } else
 	keep++;
@@ -1118,6 +1879,14 @@ void LIgaussian(double *Y,      /* gaussian outcome variable */
 	R_FlushConsole(); 
       }
     }
+
+    /** checkpoint; the draws kept so far are written out first **/
+    if (ck && (main_loop % *ckevery == 0) && (main_loop < *n_gen)) {
+      n_done = main_loop;
+      SinkSync(sink);
+      CkptSave(ck);
+    }
+
     R_FlushConsole();
     R_CheckUserInterrupt();
   } /* end of Gibbs sampler */
@@ -1125,11 +1894,37 @@ void LIgaussian(double *Y,      /* gaussian outcome variable */
   /** write out the random seed **/
   PutRNGstate();
 
+  /** write out the profile **/
+  ProfAccept(acceptC, n_covC*2);
+  ProfAccept(acceptR, n_covR);
+  ProfWrite(profile);
+
+  /** write out the convergence status **/
+  if (mon) {
+    MonWrite(mon, stopped, main_loop-1, conv);
+    if (*verbose)
+      Rprintf("%s after %d iterations; smallest ESS %g, largest R-hat %g.\n",
+	      stopped ? "Converged" : "Not converged", main_loop-1,
+	      mon->min_ess, mon->max_rhat);
+    MonClose(mon);
+  }
+
+  /** close the output sink **/
+  if (sink)
+    SinkClose(sink);
+  if (ck)
+    CkptClose(ck);
+
   /** freeing memory **/
-  FreeMatrix(Xc, n_samp+n_covC);
-  FreeMatrix(Xo, n_samp+n_covO);
-  FreeMatrix(Xobs, n_obs+n_covO);
-  FreeMatrix(Xr, n_samp+n_covR);
+  free(Yobs);
+  DesignClose(Dc);
+  if (DcA)
+    DesignClose(DcA);
+  DesignClose(Dr);
+  DesignClose(Dobs);
+  DesignClose(Do);
+  free(T);
+  free(w);
   free(meano);
   free(pC);
   free(pN);
@@ -1173,8 +1968,10 @@ void LIordinal(int *Y,         /* binary outcome variable */
 	       int *AT,        /* Are there always-takers? */
 	       int *Insample,  /* Insample (=1) or population QoI? */
 	       double *dXc,    /* model matrix for compliance model */
-	       double *dXo,    /* model matrix for outcome model */
-	       double *dXr,    /* model matrix for response model */
+	       double *dXo,    /* model matrix for outcome model,
+	                        without the indicators of the
+	                        compliance types */
+	       double *dXr,    /* model matrix for response model, likewise */
 	       double *betaC,  /* coefficients for compliance model */
 	       double *betaA,  /* coefficients for always-takers model */
 	       double *gamma,  /* coefficients for outcome model */
@@ -1208,6 +2005,13 @@ void LIordinal(int *Y,         /* binary outcome variable */
 	       int *burnin,   /* number of burnin */
 	       int *iKeep,     /* keep ?th draws */
 	       int *verbose,   /* print out messages */
+	       char **outfile, /* file to which kept draws are streamed;
+				  "" keeps them in the storage below */
+	       char **ckfile,  /* checkpoint file; "" for none */
+	       int *ckevery,   /* write a checkpoint every ?th iteration */
+	       int *resume,    /* resume the chain from the checkpoint? */
+	       int *nthread,   /* # of threads for the population QoI */
+	       int *single,    /* keep a float copy of the covariates? */
 	       double *coefC,  /* Storage for coefficients of the
 				  compliance model */
 	       double *coefA,  /* Storage for coefficients of the
@@ -1217,7 +2021,8 @@ void LIordinal(int *Y,         /* binary outcome variable */
 	       double *coefR,  /* Storage for coefficients of the
 				  response model */	      
 	       double *tauO,   /* Storage for taus */
-	       double *QoI     /* Storage of quantities of interest */
+	       double *QoI,    /* Storage of quantities of interest */
+	       double *profile /* time spent in each phase and counters */
 	       ) {
   /** counters **/
   int n_samp = *in_samp;
@@ -1230,14 +2035,15 @@ void LIordinal(int *Y,         /* binary outcome variable */
   /*** data ***/
   /*** observed Y ***/
   int *Yobs = intArray(n_obs);
-  /* covariates for the compliance model */
-  double **Xc = doubleMatrix(n_samp+n_covC, n_covC+1);
+  /* covariates for the compliance and response models, read in
+     place (see CompDesigns), and the indicators of the compliance
+     types */
+  colDesign *Dc, *DcA, *Dr;
+  double *T;
   /* covariates for the outcome model */
-  double **Xo = doubleMatrix(n_samp+n_covO, n_covO+1);    
+  colDesign *Do;
   /* covariates for the outcome model: only units with observed Y */     
   double **Xobs = doubleMatrix(n_obs+n_covO, n_covO+1);    
-  /* covariates for the response model: includes all obs */     
-  double **Xr = doubleMatrix(n_samp+n_covR, n_covR+1);    
   /* mean vector for the outcome model */
   double *meano = doubleArray(n_samp);
 
@@ -1281,15 +2087,22 @@ void LIordinal(int *Y,         /* binary outcome variable */
   int itempP = ftrunc((double) *n_gen/10);
   int itemp, itempA, itempC, itempO, itempQ, itempR, itempT;
   double dtemp, dtemp1;
+  drawSink *sink = NULL;   /* output sink for kept draws */
+  ckptState *ck = NULL;    /* checkpoint of the sampler */
+  int n_done = 0;          /* # of iterations already done */
 
   /*** get random seed **/
   GetRNGstate();
 
   /*** Preparing ***/
-  Prep(dXc, Xc, dXo, Xo, dXr, Xr, Xobs, R, n_samp, n_obs, n_covC,
-       n_covO, n_covR, *logitC, *AT, dA0C, A0C, dA0O, A0O, 1, dA0R, 
-       A0R, beta0, delta0, gamma0, pC, pN, pA, prC, prN, prA, acceptC,
-       acceptR, n_miss); 
+  CompDesigns(dXc, dXr, C, Z, A, n_samp, n_covC, n_covR, *logitC,
+	      *logitR, *AT, n_miss, dA0C, dA0R, beta0, delta0, *single, 0,
+	      NULL, NULL, NULL, NULL, NULL, NULL, &T, &Dc, &DcA, &Dr);
+  Prep(dXo, T, Xobs, R, n_samp, n_obs, n_covC, n_covO, n_covR, *logitC,
+       *AT, dA0C, A0C, dA0O, A0O, 1, dA0R, A0R, gamma0, pC, pN, pA,
+       prC, prN, prA, acceptC, acceptR);
+  Do = DesignOpen(dXo, n_samp, n_covO, n_covO, T, *AT ? 3 : 2, NULL,
+		  NULL, NULL, NULL, NULL, NULL, *single);
 
   /*** observed Y ***/
   itemp = 0;
@@ -1297,33 +2110,79 @@ void LIordinal(int *Y,         /* binary outcome variable */
     if (R[i] == 1) 
       Yobs[itemp++] = Y[i];
   
+  /*** stream the kept draws to a file? ***/
+  if (strlen(*outfile) > 0) {
+    sink = SinkOpen(*outfile);
+    QoI = SinkBlock(sink, "QoI", 2 + (*n_cat-1)*(*AT ? 6 : 5));
+    if (*param) {
+      tauO = SinkBlock(sink, "tau", *n_cat-1);
+      coefC = SinkBlock(sink, "coefC", n_covC);
+      if (*AT)
+	coefA = SinkBlock(sink, "coefA", n_covC);
+      coefO = SinkBlock(sink, "coefO", n_covO);
+      if (n_miss > 0)
+	coefR = SinkBlock(sink, "coefR", n_covR);
+    }
+  }
+
+  /*** checkpoint the sampler or resume it? ***/
+  if (strlen(*ckfile) > 0) {
+    ck = CkptComp(*ckfile, n_samp, n_covC, n_covO, n_covR, *n_gen, *burnin,
+		  *iKeep, *AT, *logitC, *param, C, A, D, betaC, betaA, delta,
+		  acceptC, acceptR, pC, pN, pA, prC, prN, prA, T, &n_done,
+		  &keep, &progress, &itempP, sink);
+    CkptConst(ck, "n_cat", n_cat, 1);
+    CkptDouble(ck, "gamma", gamma, n_covO);
+    CkptDouble(ck, "tau", tau, *n_cat-1);
+    CkptInt(ck, "acceptO", acceptO, 1);
+    if (*resume) {
+      CkptLoad(ck);
+      CompSync(*AT, Dr, NULL, Xobs, R);
+    }
+  } else if (*resume)
+    error("LIordinal: no checkpoint to resume from.\n");
+  if (sink) {
+    if (ck && *resume)
+      SinkResume(sink);
+    else
+      SinkStart(sink);
+  }
+
   /*** Gibbs Sampler! ***/
+  ProfReset();
+  ProfAcceptStart(acceptC, n_covC*2);
+  ProfAcceptStart(acceptR, n_covR);
+  ProfAcceptStart(acceptO, 1);
   itempA = 0; itempC = 0; itempO = 0; itempQ = 0; itempR = 0; itempT = 0;  
-  for (main_loop = 1; main_loop <= *n_gen; main_loop++){
+  for (main_loop = n_done+1; main_loop <= *n_gen; main_loop++){
 
     /* Step 1: RESPONSE MODEL */
-    if (n_miss > 0)
-      Response(*logitR, R, Xr, delta, n_samp, n_covR, delta0, A0R, VarR,
-	       acceptR, *mda, *AT, Z, D, prC, prN, prA);
+    if (n_miss > 0) {
+      ProfPhase(PROF_RESPONSE);
+      Response(*logitR, R, Dr, delta, delta0, A0R, VarR, acceptR,
+	       *mda, *AT, Z, D, prC, prN, prA, NULL);
+    }
 
     /** Step 2: COMPLIANCE MODEL **/    
-    Compliance(*logitC, *AT, C, Xc, betaC, n_samp, n_covC, beta0, A0C, 
-	       betaA, VarC, acceptC, *mda, A);
+    ProfPhase(PROF_COMPLIANCE);
+    Compliance(*logitC, *AT, C, Dc, DcA, betaC, beta0, A0C, betaA,
+	       VarC, acceptC, *mda, A, NULL);
 
     /* Step 3: SAMPLE COMPLIANCE COVARITE */
-    SampleComp(n_samp, n_covC, *AT, Xc, Xo, Xr, Xobs, betaC, betaA,
-	       *logitC, qC, qN, Z, D, R, RD, C, A, pC, pN, pA, prA, prN, prC);
+    ProfPhase(PROF_LATENT);
+    SampleComp(*AT, Dc, Dr, NULL, Xobs, betaC, betaA, *logitC,
+	       qC, qN, Z, D, R, RD, C, A, pC, pN, pA, prA, prN, prC);
 
     /** Step 4: OUTCOME MODEL **/
+    ProfPhase(PROF_OUTCOME);
     boprobitMCMC(Yobs, Xobs, gamma, tau, n_obs, n_covO, *n_cat,
 		 0, gamma0, A0O, *mda, 1, VarO, acceptO, 1);
 
     /** Compute probabilities of Y = 1 **/
+    ProfPhase(PROF_PROB);
+    DesignXBeta(Do, *AT ? 3 : 2, n_covO, gamma, meano);
     for (i = 0; i < n_samp; i++) {
-      meano[i] = 0;
       if (*AT) { /* always-takers */
-	for (j = 3; j < n_covO; j++)
-	  meano[i] += Xo[i][j]*gamma[j];
 	if (R[i] == 1) {
 	  if ((RD[i] == 0) || (Z[i] == D[i])) {
 	    if (Y[i] == 0) {
@@ -1345,8 +2204,6 @@ void LIordinal(int *Y,         /* binary outcome variable */
 	  }
 	}
       } else { /* no always-takers */
-	for (j = 2; j < n_covO; j++)
-	  meano[i] += Xo[i][j]*gamma[j];
 	if (R[i] == 1) 
 	  if ((Z[i] == 0) || (RD[i] == 0)) {
 	    if (Y[i] == 0) {
@@ -1366,9 +2223,11 @@ void LIordinal(int *Y,         /* binary outcome variable */
     }
 
     /** storing the results **/
+    ProfPhase(PROF_STORE);
     if (main_loop > *burnin) {
       if (keep == *iKeep) {
 	/** Computing Quantities of Interest **/
+	ProfPhase(PROF_QOI);
 	n_comp[0] = 0; n_comp[1] = 0; 
 	n_never[0] = 0; n_never[1] = 0;
 	n_always[0] = 0; n_always[1] = 0;
@@ -1444,35 +2303,11 @@ void LIordinal(int *Y,         /* binary outcome variable */
 					    -pnorm(tau[j-1], meano[i], 1, 1, 0)));		
 	      }
 	    }
-	  } else { /* population QoI */
-	    for (j = 1; j < *n_cat; j++) {
-	      /* compliers */
-	      if (j == (*n_cat-1)) {
-		dtemp = pnorm(tau[*n_cat-2], meano[i]+gamma[0], 1, 0, 0);
-		dtemp1 = pnorm(tau[*n_cat-2], meano[i]+gamma[1], 1, 0, 0);
-	      } else {
-		dtemp = (pnorm(tau[j], meano[i]+gamma[0], 1, 1, 0) 
-			 -pnorm(tau[j-1], meano[i]+gamma[0], 1, 1, 0));
-		dtemp1 = (pnorm(tau[j], meano[i]+gamma[1], 1, 1, 0) 
-			  -pnorm(tau[j-1], meano[i]+gamma[1], 1, 1, 0));
-	      }
-	      Y1barC[j-1] += dtemp; Y0barC[j-1] += dtemp1;
-	      ITT[j-1] += ((dtemp-dtemp1)*qC[i]);
-	      /* always-takers */
-	      if (j == (*n_cat-1))
-		YbarA[j-1] += pnorm(tau[*n_cat-2], meano[i]+gamma[2], 1, 0, 0);
-	      else
-		YbarA[j-1] += (pnorm(tau[j], meano[i]+gamma[2], 1, 1, 0) 
-			       -pnorm(tau[j-1], meano[i]+gamma[2], 1, 1, 0));
-	      /* never-takers */
-	      if (j == (*n_cat-1))
-		YbarN[j-1] += pnorm(tau[*n_cat-2], meano[i], 1, 0, 0);
-	      else
-		YbarN[j-1] += (pnorm(tau[j], meano[i], 1, 1, 0) 
-			       -pnorm(tau[j-1], meano[i], 1, 1, 0));
-	    }
 	  }
 	}
+	if (!*Insample) /* population QoI */
+	  PopQoIordinal(n_samp, *n_cat, *AT, meano, gamma, tau, qC, *nthread,
+			Y1barC, Y0barC, YbarN, YbarA, ITT);
 
 	p_comp /= (double)n_samp;  /* ITT effect on D; Prob. of being
 				      a complier */ 
@@ -1495,6 +2330,7 @@ void LIordinal(int *Y,         /* binary outcome variable */
 	  }
 	  CACE[j] = Y1barC[j]-Y0barC[j];    /* CACE */
 	}
+	ProfPhase(PROF_STORE);
 
 	for (j = 0; j < (*n_cat-1); j++) 
 	  QoI[itempQ++] = ITT[j];   
@@ -1532,6 +2368,10 @@ void LIordinal(int *Y,         /* binary outcome variable */
 	    for (j = 0; j < n_covR; j++)
 	      coefR[itempR++] = delta[j];
 	}
+	if (sink) { /* the storage holds the current draw only */
+	  SinkCommit(sink);
+	  itempA = 0; itempC = 0; itempO = 0; itempQ = 0; itempR = 0; itempT = 0;
+	}
 	keep = 1;
       } else
 	keep++;
@@ -1562,6 +2402,14 @@ void LIordinal(int *Y,         /* binary outcome variable */
 	R_FlushConsole(); 
       }
     }
+
+    /** checkpoint; the draws kept so far are written out first **/
+    if (ck && (main_loop % *ckevery == 0) && (main_loop < *n_gen)) {
+      n_done = main_loop;
+      SinkSync(sink);
+      CkptSave(ck);
+    }
+
     R_FlushConsole();
     R_CheckUserInterrupt();
   } /* end of Gibbs sampler */
@@ -1569,12 +2417,27 @@ void LIordinal(int *Y,         /* binary outcome variable */
   /** write out the random seed **/
   PutRNGstate();
 
+  /** write out the profile **/
+  ProfAccept(acceptC, n_covC*2);
+  ProfAccept(acceptR, n_covR);
+  ProfAccept(acceptO, 1);
+  ProfWrite(profile);
+
+  /** close the output sink **/
+  if (sink)
+    SinkClose(sink);
+  if (ck)
+    CkptClose(ck);
+
   /** freeing memory **/
   free(Yobs);
-  FreeMatrix(Xc, n_samp+n_covC);
-  FreeMatrix(Xo, n_samp+n_covO);
+  DesignClose(Dc);
+  if (DcA)
+    DesignClose(DcA);
+  DesignClose(Dr);
+  DesignClose(Do);
+  free(T);
   FreeMatrix(Xobs, n_obs+n_covO);
-  FreeMatrix(Xr, n_samp+n_covR);
   free(meano);
   free(pC);
   free(pN);
@@ -1625,8 +2488,10 @@ void LIcount(int *Y,         /*count outcome variable */
 	     int *AT,        /* Are there always-takers? */
 	     int *Insample,  /* Insample (=1) or population QoI? */
 	     double *dXc,    /* model matrix for compliance model */
-	     double *dXo,    /* model matrix for outcome model */
-	     double *dXr,    /* model matrix for response model */
+	     double *dXo,    /* model matrix for outcome model,
+	                      without the indicators of the
+	                      compliance types */
+	     double *dXr,    /* model matrix for response model, likewise */
 	     double *betaC,  /* coefficients for compliance model */
 	     double *betaA,  /* coefficients for always-takers model */
 	     double *gamma,  /* coefficients for outcome model */
@@ -1660,6 +2525,14 @@ void LIcount(int *Y,         /*count outcome variable */
 	     int *burnin,   /* number of burnin */
 	     int *iKeep,     /* keep ?th draws */
 	     int *verbose,   /* print out messages */
+	     char **outfile, /* file to which kept draws are streamed;
+				"" keeps them in the storage below */
+	     char **ckfile,  /* checkpoint file; "" for none */
+	     int *ckevery,   /* write a checkpoint every ?th iteration */
+	     int *resume,    /* resume the chain from the checkpoint? */
+	     int *nthread,   /* # of threads for the population QoI */
+	     int *rb,        /* Rao-Blackwellize the insample QoI? */
+	     int *single,    /* keep a float copy of the covariates? */
 	     double *coefC,  /* Storage for coefficients of the
 				compliance model */
 	     double *coefA,  /* Storage for coefficients of the
@@ -1669,7 +2542,8 @@ void LIcount(int *Y,         /*count outcome variable */
 	     double *coefR,  /* Storage for coefficients of the
 				response model */	      
 	     double *var,    /* Storage for sig2 */
-	     double *QoI     /* Storage of quantities of interest */
+	     double *QoI,    /* Storage of quantities of interest */
+	     double *profile /* time spent in each phase and counters */
 	     ) {
   /** counters **/
   int n_samp = *in_samp;
@@ -1682,14 +2556,15 @@ void LIcount(int *Y,         /*count outcome variable */
   /*** data ***/
   /*** observed Y ***/
   int *Yobs = intArray(n_obs);
-  /* covariates for the compliance model */
-  double **Xc = doubleMatrix(n_samp+n_covC, n_covC+1);
+  /* covariates for the compliance and response models, read in
+     place (see CompDesigns), and the indicators of the compliance
+     types */
+  colDesign *Dc, *DcA, *Dr;
+  double *T;
   /* covariates for the outcome model */
-  double **Xo = doubleMatrix(n_samp, n_covO);    
+  colDesign *Do;
   /* covariates for the outcome model: only units with observed Y */     
   double **Xobs = doubleMatrix(n_obs, n_covO);    
-  /* covariates for the response model: includes all obs */     
-  double **Xr = doubleMatrix(n_samp+n_covR, n_covR+1);    
   /* mean vector for the outcome model */
   double *meano = doubleArray(n_samp);
 
@@ -1718,6 +2593,7 @@ void LIcount(int *Y,         /*count outcome variable */
   int *n_comp = intArray(2);          /* number of compliers */
   int *n_never = intArray(2);
   int *n_always = intArray(2);
+  double n_type[3];  /* expected # of each type */
   double p_comp, p_never; /* prob. of being a particular type */
 
   /*** storage parameters and loop counters **/
@@ -1730,15 +2606,22 @@ void LIcount(int *Y,         /*count outcome variable */
   int itempP = ftrunc((double) *n_gen/10);
   int itemp, itempA, itempC, itempO, itempQ, itempR, itempS;
   double dtemp, dtemp1;
+  drawSink *sink = NULL;   /* output sink for kept draws */
+  ckptState *ck = NULL;    /* checkpoint of the sampler */
+  int n_done = 0;          /* # of iterations already done */
 
   /*** get random seed **/
   GetRNGstate();
 
   /*** Preparing ***/
-  Prep(dXc, Xc, dXo, Xo, dXr, Xr, Xobs, R, n_samp, n_obs, n_covC,
-       n_covO, n_covR, *logitC, *AT, dA0C, A0C, dA0O, A0O, 0, dA0R, 
-       A0R, beta0, delta0, gamma0, pC, pN, pA, prC, prN, prA, acceptC,
-       acceptR, n_miss); 
+  CompDesigns(dXc, dXr, C, Z, A, n_samp, n_covC, n_covR, *logitC,
+	      *logitR, *AT, n_miss, dA0C, dA0R, beta0, delta0, *single, 0,
+	      NULL, NULL, NULL, NULL, NULL, NULL, &T, &Dc, &DcA, &Dr);
+  Prep(dXo, T, Xobs, R, n_samp, n_obs, n_covC, n_covO, n_covR, *logitC,
+       *AT, dA0C, A0C, dA0O, A0O, 0, dA0R, A0R, gamma0, pC, pN, pA,
+       prC, prN, prA, acceptC, acceptR);
+  Do = DesignOpen(dXo, n_samp, n_covO, n_covO, T, *AT ? 3 : 2, NULL,
+		  NULL, NULL, NULL, NULL, NULL, *single);
 
   /*** observed Y ***/
   itemp = 0;
@@ -1750,33 +2633,78 @@ void LIcount(int *Y,         /*count outcome variable */
     cont[i] = 0;
   acceptO[0] = 0; acceptO[1] = 0;
 
+  /*** stream the kept draws to a file? ***/
+  if (strlen(*outfile) > 0) {
+    sink = SinkOpen(*outfile);
+    QoI = SinkBlock(sink, "QoI", *AT ? 8 : 7);
+    if (*param) {
+      coefC = SinkBlock(sink, "coefC", n_covC);
+      if (*AT)
+	coefA = SinkBlock(sink, "coefA", n_covC);
+      coefO = SinkBlock(sink, "coefO", n_covO);
+      var = SinkBlock(sink, "sig2", 1);
+      if (n_miss > 0)
+	coefR = SinkBlock(sink, "coefR", n_covR);
+    }
+  }
+
+  /*** checkpoint the sampler or resume it? ***/
+  if (strlen(*ckfile) > 0) {
+    ck = CkptComp(*ckfile, n_samp, n_covC, n_covO, n_covR, *n_gen, *burnin,
+		  *iKeep, *AT, *logitC, *param, C, A, D, betaC, betaA, delta,
+		  acceptC, acceptR, pC, pN, pA, prC, prN, prA, T, &n_done,
+		  &keep, &progress, &itempP, sink);
+    CkptDouble(ck, "gamma", gamma, n_covO);
+    CkptDouble(ck, "sig2", sig2, 1);
+    CkptInt(ck, "acceptO", acceptO, 2);
+    if (*resume) {
+      CkptLoad(ck);
+      CompSync(*AT, Dr, NULL, Xobs, R);
+    }
+  } else if (*resume)
+    error("LIcount: no checkpoint to resume from.\n");
+  if (sink) {
+    if (ck && *resume)
+      SinkResume(sink);
+    else
+      SinkStart(sink);
+  }
+
   /*** Gibbs Sampler! ***/
+  ProfReset();
+  ProfAcceptStart(acceptC, n_covC*2);
+  ProfAcceptStart(acceptR, n_covR);
+  ProfAcceptStart(acceptO, 2);
   itempA = 0; itempC = 0; itempO = 0; itempQ = 0; itempR = 0; itempS = 0;
-  for (main_loop = 1; main_loop <= *n_gen; main_loop++){
+  for (main_loop = n_done+1; main_loop <= *n_gen; main_loop++){
 
     /* Step 1: RESPONSE MODEL */
-    if (n_miss > 0)
-      Response(*logitR, R, Xr, delta, n_samp, n_covR, delta0, A0R, VarR,
-	       acceptR, *mda, *AT, Z, D, prC, prN, prA);
+    if (n_miss > 0) {
+      ProfPhase(PROF_RESPONSE);
+      Response(*logitR, R, Dr, delta, delta0, A0R, VarR, acceptR,
+	       *mda, *AT, Z, D, prC, prN, prA, NULL);
+    }
 
     /** Step 2: COMPLIANCE MODEL **/
-    Compliance(*logitC, *AT, C, Xc, betaC, n_samp, n_covC, beta0, A0C, 
-	       betaA, VarC, acceptC, *mda, A);
+    ProfPhase(PROF_COMPLIANCE);
+    Compliance(*logitC, *AT, C, Dc, DcA, betaC, beta0, A0C, betaA,
+	       VarC, acceptC, *mda, A, NULL);
 
     /* Step 3: SAMPLE COMPLIANCE COVARITE */
-    SampleComp(n_samp, n_covC, *AT, Xc, Xo, Xr, Xobs, betaC, betaA,
-	       *logitC, qC, qN, Z, D, R, RD, C, A, pC, pN, pA, prA, prN, prC);
+    ProfPhase(PROF_LATENT);
+    SampleComp(*AT, Dc, Dr, NULL, Xobs, betaC, betaA, *logitC,
+	       qC, qN, Z, D, R, RD, C, A, pC, pN, pA, prA, prN, prC);
 
     /** Step 4: OUTCOME MODEL **/
+    ProfPhase(PROF_OUTCOME);
     negbinMetro(Yobs, Xobs, gamma, sig2, n_obs, n_covO, gamma0, A0O,
 		*a0, *b0, VarO, *VarS, cont, 1, acceptO, 0);
 
     /** Compute probabilities of Y = 1 **/
+    ProfPhase(PROF_PROB);
+    DesignXBeta(Do, *AT ? 3 : 2, n_covO, gamma, meano);
     for (i = 0; i < n_samp; i++) {
-      meano[i] = 0;
       if (*AT) { /* always-takers */
-	for (j = 3; j < n_covO; j++)
-	  meano[i] += Xo[i][j]*gamma[j];
 	if (R[i] == 1) {
 	  if ((RD[i] == 0) || (Z[i] == D[i])) {
 	    pC[i] = dnegbin(Y[i], exp(meano[i]+gamma[1-Z[i]]), *sig2, 0);
@@ -1785,8 +2713,6 @@ void LIcount(int *Y,         /*count outcome variable */
 	  } 
 	}
       } else { /* no always-takers */
-	for (j = 2; j < n_covO; j++)
-	  meano[i] += Xo[i][j]*gamma[j];
 	if (R[i] == 1)
 	  if ((Z[i] == 0) || (RD[i] == 0)) {
 	    pC[i] = dnegbin(Y[i], exp(meano[i]+gamma[1-Z[i]]), *sig2, 0);
@@ -1796,9 +2722,11 @@ void LIcount(int *Y,         /*count outcome variable */
     }
 
     /** storing the results **/
+    ProfPhase(PROF_STORE);
     if (main_loop > *burnin) {
       if (keep == *iKeep) {
 	/** Computing Quantities of Interest **/
+	ProfPhase(PROF_QOI);
 	n_comp[0] = 0; n_comp[1] = 0; 
 	n_never[0] = 0; n_never[1] = 0;
 	n_always[0] = 0; n_always[1] = 0;
@@ -1822,7 +2750,7 @@ void LIcount(int *Y,         /*count outcome variable */
 	      else
 		n_never[0]++;
 	  }
-	  if (*Insample) { /* insample QoI */
+	  if (*Insample && !*rb) { /* insample QoI */
 	    if (C[i] == 1) {
 	      dtemp = rnegbin(exp(meano[i]+gamma[0]), *sig2);
 	      dtemp1 = rnegbin(exp(meano[i]+gamma[1]), *sig2);
@@ -1845,29 +2773,26 @@ void LIcount(int *Y,         /*count outcome variable */
 	      else 
 		YbarN += rnegbin(exp(meano[i]), *sig2);
 	    } 
-	  } else { /* population QoI */
-	    /* compliers */
-	    dtemp = exp(meano[i]+gamma[0]);
-	    dtemp1 = exp(meano[i]+gamma[1]); 
-	    Y1barC += dtemp; Y0barC += dtemp1;
-	    ITT += ((dtemp-dtemp1)*qC[i]);
-	    /* always-takers */
-	    YbarA += exp(meano[i]+gamma[2]);
-	    /* never-takers */
-	    YbarN += exp(meano[i]);
 	  }
 	}
+	if (!*Insample) /* population QoI */
+	  PopQoI(QOI_NEGBIN, n_samp, *AT, meano, gamma, NULL, NULL, 0, qC,
+		 *nthread, &Y1barC, &Y0barC, &YbarN, &YbarA, &ITT);
+	else if (*rb) /* Rao-Blackwellized insample QoI */
+	  InsampleRB(QOI_NEGBIN, n_samp, *AT, Y, NULL, R, Z, D, RD, meano,
+		     gamma, NULL, NULL, *sig2, qC, qN, pC, pN, pA, prC, prN,
+		     prA, &Y1barC, &Y0barC, &YbarN, &YbarA, n_type);
 
 	p_comp /= (double)n_samp;  /* ITT effect on D; Prob. of being
 				      a complier */ 
 	p_never /= (double)n_samp; /* Prob. of being a never-taker */
 	if (*Insample) {
 	  ITT = (Y1barC-Y0barC)/(double)n_samp;     /* ITT effect */
-	  Y1barC /= (double)(n_comp[0]+n_comp[1]);  
-	  Y0barC /= (double)(n_comp[0]+n_comp[1]); 
-	  YbarN /= (double)(n_never[0]+n_never[1]);
+	  Y1barC /= *rb ? n_type[0] : (double)(n_comp[0]+n_comp[1]);
+	  Y0barC /= *rb ? n_type[0] : (double)(n_comp[0]+n_comp[1]);
+	  YbarN /= *rb ? n_type[1] : (double)(n_never[0]+n_never[1]);
 	  if (*AT)
-	    YbarA /= (double)(n_always[0]+n_always[1]);
+	    YbarA /= *rb ? n_type[2] : (double)(n_always[0]+n_always[1]);
 	} else {
 	  ITT /= (double)n_samp;     /* ITT effect */
 	  Y1barC /= (double)n_samp;
@@ -1877,6 +2802,7 @@ void LIcount(int *Y,         /*count outcome variable */
 	    YbarA /= (double)n_samp;
 	}
 	CACE = Y1barC-Y0barC;    /* CACE */
+	ProfPhase(PROF_STORE);
     
 	QoI[itempQ++] = ITT;   
 	QoI[itempQ++] = CACE;   
@@ -1907,6 +2833,10 @@ void LIcount(int *Y,         /*count outcome variable */
 	    for (j = 0; j < n_covR; j++)
 	      coefR[itempR++] = delta[j];
 	}
+	if (sink) { /* the storage holds the current draw only */
+	  SinkCommit(sink);
+	  itempA = 0; itempC = 0; itempO = 0; itempQ = 0; itempR = 0; itempS = 0;
+	}
 	keep = 1;
       } else
 	keep++;
@@ -1939,6 +2869,14 @@ void LIcount(int *Y,         /*count outcome variable */
 	R_FlushConsole(); 
       }
     }
+
+    /** checkpoint; the draws kept so far are written out first **/
+    if (ck && (main_loop % *ckevery == 0) && (main_loop < *n_gen)) {
+      n_done = main_loop;
+      SinkSync(sink);
+      CkptSave(ck);
+    }
+
     R_FlushConsole();
     R_CheckUserInterrupt();
   } /* end of Gibbs sampler */
@@ -1946,12 +2884,27 @@ void LIcount(int *Y,         /*count outcome variable */
   /** write out the random seed **/
   PutRNGstate();
 
+  /** write out the profile **/
+  ProfAccept(acceptC, n_covC*2);
+  ProfAccept(acceptR, n_covR);
+  ProfAccept(acceptO, 2);
+  ProfWrite(profile);
+
+  /** close the output sink **/
+  if (sink)
+    SinkClose(sink);
+  if (ck)
+    CkptClose(ck);
+
   /** freeing memory **/
   free(Yobs);
-  FreeMatrix(Xc, n_samp+n_covC);
-  FreeMatrix(Xo, n_samp);
+  DesignClose(Dc);
+  if (DcA)
+    DesignClose(DcA);
+  DesignClose(Dr);
+  DesignClose(Do);
+  free(T);
   FreeMatrix(Xobs, n_obs);
-  FreeMatrix(Xr, n_samp+n_covR);
   free(meano);
   free(cont);
   free(pC);
@@ -1997,8 +2950,10 @@ void LItwopart(int *Y,      /* indicator variable; Y > 0 */
 	       int *AT,        /* Are there always-takers? */
 	       int *Insample,  /* Insample (=1) or population QoI? */
 	       double *dXc,    /* model matrix for compliance model */
-	       double *dXo,    /* model matrix for outcome model */
-	       double *dXr,    /* model matrix for response model */
+	       double *dXo,    /* model matrix for outcome model,
+	                        without the indicators of the
+	                        compliance types */
+	       double *dXr,    /* model matrix for response model, likewise */
 	       double *betaC,  /* coefficients for compliance model */
 	       double *betaA,  /* coefficients for always-takers model */
 	       double *gamma,  /* coefficients for outcome model 1 */
@@ -2033,6 +2988,14 @@ void LItwopart(int *Y,      /* indicator variable; Y > 0 */
 	       int *burnin,   /* number of burnin */
 	       int *iKeep,     /* keep ?th draws */
 	       int *verbose,   /* print out messages */
+	       char **outfile, /* file to which kept draws are streamed;
+				  "" keeps them in the storage below */
+	       char **ckfile,  /* checkpoint file; "" for none */
+	       int *ckevery,   /* write a checkpoint every ?th iteration */
+	       int *resume,    /* resume the chain from the checkpoint? */
+	       int *nthread,   /* # of threads for the population QoI */
+	       int *rb,        /* Rao-Blackwellize the insample QoI? */
+	       int *single,    /* keep a float copy of the covariates? */
 	       double *coefC,  /* Storage for coefficients of the
 				  compliance model */
 	       double *coefA,  /* Storage for coefficients of the
@@ -2044,7 +3007,8 @@ void LItwopart(int *Y,      /* indicator variable; Y > 0 */
 	       double *coefR,  /* Storage for coefficients of the
 				  response model */	      
 	       double *var,    /* Storage for sig2 */
-	       double *QoI     /* Storage of quantities of interest */
+	       double *QoI,    /* Storage of quantities of interest */
+	       double *profile /* time spent in each phase and counters */
 	       ) {
   /** counters **/
   int n_samp = in_samp[0];
@@ -2056,16 +3020,17 @@ void LItwopart(int *Y,      /* indicator variable; Y > 0 */
   int n_obs = n_samp - n_miss;
 
   /*** data ***/
-  /* covariates for the compliance model */
-  double **Xc = doubleMatrix(n_samp+n_covC, n_covC+1);
+  /* covariates for the compliance and response models, read in
+     place (see CompDesigns), and the indicators of the compliance
+     types */
+  colDesign *Dc, *DcA, *Dr;
+  double *T;
   /* covariates for the outcome model */
-  double **Xo = doubleMatrix(n_samp+n_covO, n_covO+1);    
+  colDesign *Do;
   /* covariates for the outcome model: only units with observed Y */     
   double **Xobs = doubleMatrix(n_obs+n_covO, n_covO+1);    
   double **Xobs1 = doubleMatrix(n_samp1+n_covO, n_covO+1);    
   int *Yobs = intArray(n_obs); 
-  /* covariates for the response model: includes all obs */     
-  double **Xr = doubleMatrix(n_samp+n_covR, n_covR+1);    
   /* mean vector for the outcome model */
   double *meano = doubleArray(n_samp);
   double *meano1 = doubleArray(n_samp);
@@ -2094,6 +3059,7 @@ void LItwopart(int *Y,      /* indicator variable; Y > 0 */
   int *n_comp = intArray(2);          /* number of compliers */
   int *n_never = intArray(2);
   int *n_always = intArray(2);
+  double n_type[3];  /* expected # of each type */
   double p_comp, p_never; /* prob. of being a particular type */
 
   /*** storage parameters and loop counters **/
@@ -2105,23 +3071,31 @@ void LItwopart(int *Y,      /* indicator variable; Y > 0 */
   int itempP = ftrunc((double) *n_gen/10);
   int itemp, itempA, itempC, itempO, itempO1, itempQ, itempR, itempS;
   double dtemp, dtemp1;
+  drawSink *sink = NULL;   /* output sink for kept draws */
+  ckptState *ck = NULL;    /* checkpoint of the sampler */
+  int n_done = 0;          /* # of iterations already done */
   double **mtemp = doubleMatrix(n_covO, n_covO);
 
   /*** get random seed **/
   GetRNGstate();
 
   /*** Preparing ***/
-  Prep(dXc, Xc, dXo, Xo, dXr, Xr, Xobs, R, n_samp, n_obs, n_covC,
-       n_covO, n_covR, *logitC, *AT, dA0C, A0C, dA0O, A0O, 1, dA0R, 
-       A0R, beta0, delta0, gamma0, pC, pN, pA, prC, prN, prA, acceptC,
-       acceptR, n_miss); 
+  CompDesigns(dXc, dXr, C, Z, A, n_samp, n_covC, n_covR, *logitC,
+	      *logitR, *AT, n_miss, dA0C, dA0R, beta0, delta0, *single, 0,
+	      NULL, NULL, NULL, NULL, NULL, NULL, &T, &Dc, &DcA, &Dr);
+  Prep(dXo, T, Xobs, R, n_samp, n_obs, n_covC, n_covO, n_covR, *logitC,
+       *AT, dA0C, A0C, dA0O, A0O, 1, dA0R, A0R, gamma0, pC, pN, pA,
+       prC, prN, prA, acceptC, acceptR);
+  Do = DesignOpen(dXo, n_samp, n_covO, n_covO, T, *AT ? 3 : 2, NULL,
+		  NULL, NULL, NULL, NULL, NULL, *single);
 
   /*** observed Y ***/
   itemp = 0;
   for (i = 0; i < n_samp; i++) {
     if ((R[i] == 1) && (Y[i] == 1)) {
       for (j = 0; j < n_covO; j++)
-	Xobs1[itemp][j] = Xo[i][j];
+	Xobs1[itemp][j] = j < (*AT ? 3 : 2) ? T[i+(size_t)j*n_samp] :
+	  dXo[i+(size_t)(j-(*AT ? 3 : 2))*n_samp];
       Xobs1[itemp++][n_covO] = log(Y1[i]);
     }
   }
@@ -2139,38 +3113,83 @@ void LItwopart(int *Y,      /* indicator variable; Y > 0 */
     if (R[i] == 1) 
       Yobs[itemp++] = Y[i];
 
+  /*** stream the kept draws to a file? ***/
+  if (strlen(*outfile) > 0) {
+    sink = SinkOpen(*outfile);
+    QoI = SinkBlock(sink, "QoI", *AT ? 8 : 7);
+    if (*param) {
+      coefC = SinkBlock(sink, "coefC", n_covC);
+      if (*AT)
+	coefA = SinkBlock(sink, "coefA", n_covC);
+      coefO = SinkBlock(sink, "coefO", n_covO);
+      coefO1 = SinkBlock(sink, "coefO1", n_covO);
+      var = SinkBlock(sink, "sig2", 1);
+      if (n_miss > 0)
+	coefR = SinkBlock(sink, "coefR", n_covR);
+    }
+  }
+
+  /*** checkpoint the sampler or resume it? ***/
+  if (strlen(*ckfile) > 0) {
+    ck = CkptComp(*ckfile, n_samp, n_covC, n_covO, n_covR, *n_gen, *burnin,
+		  *iKeep, *AT, *logitC, *param, C, A, D, betaC, betaA, delta,
+		  acceptC, acceptR, pC, pN, pA, prC, prN, prA, T, &n_done,
+		  &keep, &progress, &itempP, sink);
+    CkptConst(ck, "n_samp1", &n_samp1, 1);
+    CkptDouble(ck, "gamma", gamma, n_covO);
+    CkptDouble(ck, "gamma1", gamma1, n_covO);
+    CkptDouble(ck, "sig2", sig2, 1);
+    if (*resume) {
+      CkptLoad(ck);
+      CompSync(*AT, Dr, NULL, Xobs, R);
+    }
+  } else if (*resume)
+    error("LItwopart: no checkpoint to resume from.\n");
+  if (sink) {
+    if (ck && *resume)
+      SinkResume(sink);
+    else
+      SinkStart(sink);
+  }
+
   /*** Gibbs Sampler! ***/
+  ProfReset();
+  ProfAcceptStart(acceptC, n_covC*2);
+  ProfAcceptStart(acceptR, n_covR);
   itempA = 0; itempC = 0; itempO = 0; itempO1 = 0; 
   itempQ = 0; itempR = 0; itempS = 0;
-  for (main_loop = 1; main_loop <= *n_gen; main_loop++){
+  for (main_loop = n_done+1; main_loop <= *n_gen; main_loop++){
 
     /* Step 1: RESPONSE MODEL */
-    if (n_miss > 0)
-      Response(*logitR, R, Xr, delta, n_samp, n_covR, delta0, A0R, VarR,
-	       acceptR, *mda, *AT, Z, D, prC, prN, prA);
+    if (n_miss > 0) {
+      ProfPhase(PROF_RESPONSE);
+      Response(*logitR, R, Dr, delta, delta0, A0R, VarR, acceptR,
+	       *mda, *AT, Z, D, prC, prN, prA, NULL);
+    }
 
     /** Step 2: COMPLIANCE MODEL **/
-    Compliance(*logitC, *AT, C, Xc, betaC, n_samp, n_covC, beta0, A0C, 
-	       betaA, VarC, acceptC, *mda, A);
+    ProfPhase(PROF_COMPLIANCE);
+    Compliance(*logitC, *AT, C, Dc, DcA, betaC, beta0, A0C, betaA,
+	       VarC, acceptC, *mda, A, NULL);
 
     /* Step 3: SAMPLE COMPLIANCE COVARITE */
-    SampleComp(n_samp, n_covC, *AT, Xc, Xo, Xr, Xobs, betaC, betaA,
-	       *logitC, qC, qN, Z, D, R, RD, C, A, pC, pN, pA, prA, prN, prC);
+    ProfPhase(PROF_LATENT);
+    SampleComp(*AT, Dc, Dr, NULL, Xobs, betaC, betaA, *logitC,
+	       qC, qN, Z, D, R, RD, C, A, pC, pN, pA, prA, prN, prC);
 
     /** Step 4: OUTCOME MODEL **/
+    ProfPhase(PROF_OUTCOME);
     bprobitGibbs(Yobs, Xobs, gamma, n_obs, n_covO, 0, gamma0, A0O,
 		 *mda, 1);
     bNormalReg(Xobs1, gamma1, sig2, n_samp1, n_covO, 0, 1, gamma0, A0O, 1,
 	       *nu0, *s0, 0);
 
     /** Compute probabilities of Y = Yobs **/
+    ProfPhase(PROF_PROB);
+    DesignXBeta(Do, *AT ? 3 : 2, n_covO, gamma, meano);
+    DesignXBeta(Do, *AT ? 3 : 2, n_covO, gamma1, meano1);
     for (i = 0; i < n_samp; i++) {
-      meano[i] = 0; meano1[i] = 0;
       if (*AT) { /* always-takers */
-	for (j = 3; j < n_covO; j++) {
-	  meano[i] += Xo[i][j]*gamma[j];
-	  meano1[i] += Xo[i][j]*gamma1[j];
-	}
 	if (R[i] == 1) {
 	  if ((RD[i] == 0) || (Z[i] == D[i])) {
 	    if (Y[i] == 1) {
@@ -2188,10 +3207,6 @@ void LItwopart(int *Y,      /* indicator variable; Y > 0 */
 	  }
 	}
       } else { /* no always-takers */
-	for (j = 2; j < n_covO; j++) {
-	  meano[i] += Xo[i][j]*gamma[j];
-	  meano1[i] += Xo[i][j]*gamma1[j];
-	}
 	if (R[i] == 1) {
 	  if ((Z[i] == 0) || (RD[i] == 0)){
 	    if (Y[i] == 1) {
@@ -2209,9 +3224,11 @@ void LItwopart(int *Y,      /* indicator variable; Y > 0 */
     }
     
     /** storing the results **/
+    ProfPhase(PROF_STORE);
     if (main_loop > *burnin) {
       if (keep == *iKeep) {
 	/** Computing Quantities of Interest **/
+	ProfPhase(PROF_QOI);
 	n_comp[0] = 0; n_comp[1] = 0; 
 	n_never[0] = 0; n_never[1] = 0;
 	n_always[0] = 0; n_always[1] = 0;
@@ -2235,7 +3252,7 @@ void LItwopart(int *Y,      /* indicator variable; Y > 0 */
 	      else
 		n_never[0]++;
 	  }
-	  if (*Insample) { /* insample QoI */
+	  if (*Insample && !*rb) { /* insample QoI */
 	    if (C[i] == 1) {
 	      dtemp = rlnorm(meano1[i]+gamma1[0], sqrt(*sig2)) *
 		((meano[i]+gamma[0]+norm_rand()) > 0);
@@ -2262,32 +3279,27 @@ void LItwopart(int *Y,      /* indicator variable; Y > 0 */
 		YbarN += rlnorm(meano1[i], sqrt(*sig2)) *
 		  ((meano[i]+gamma[2]+norm_rand()) > 0);
 	    } 
-	  } else { /* population QoI */
-	    /* compliers */
-	    dtemp = exp(meano1[i]+gamma1[0]+0.5*sig2[0]) * 
-	      pnorm(meano[i]+gamma[0], 0, 1, 1, 0);
-	    dtemp1 = exp(meano1[i]+gamma1[1]+0.5*sig2[0]) * 
-	      pnorm(meano[i]+gamma[1], 0, 1, 1, 0); 
-	    Y1barC += dtemp; Y0barC += dtemp1;
-	    ITT += ((dtemp-dtemp1)*qC[i]);
-	    /* always-takers */
-	    YbarA += exp(meano1[i]+gamma1[2]+0.5*sig2[0]) * 
-	      pnorm(meano[i]+gamma[2], 0, 1, 1, 0);
-	    /* never-takers */
-	    YbarN += exp(meano1[i]+0.5*sig2[0]) * pnorm(meano[i], 0, 1, 1, 0);
 	  }
 	}
+	if (!*Insample) /* population QoI */
+	  PopQoI(QOI_TWOPART, n_samp, *AT, meano, gamma, meano1, gamma1,
+		 sig2[0], qC, *nthread, &Y1barC, &Y0barC, &YbarN, &YbarA, &ITT);
+	else if (*rb) /* Rao-Blackwellized insample QoI */
+	  InsampleRB(QOI_TWOPART, n_samp, *AT, NULL, Y1, R, Z, D, RD, meano,
+		     gamma, meano1, gamma1, sig2[0], qC, qN, pC, pN, pA,
+		     prC, prN, prA, &Y1barC, &Y0barC, &YbarN, &YbarA,
+		     n_type);
 
 	p_comp /= (double)n_samp;  /* ITT effect on D; Prob. of being
 				      a complier */ 
 	p_never /= (double)n_samp; /* Prob. of being a never-taker */
 	if (*Insample) {
 	  ITT = (Y1barC-Y0barC)/(double)n_samp;     /* ITT effect */
-	  Y1barC /= (double)(n_comp[0]+n_comp[1]);  
-	  Y0barC /= (double)(n_comp[0]+n_comp[1]); 
-	  YbarN /= (double)(n_never[0]+n_never[1]);
+	  Y1barC /= *rb ? n_type[0] : (double)(n_comp[0]+n_comp[1]);
+	  Y0barC /= *rb ? n_type[0] : (double)(n_comp[0]+n_comp[1]);
+	  YbarN /= *rb ? n_type[1] : (double)(n_never[0]+n_never[1]);
 	  if (*AT)
-	    YbarA /= (double)(n_always[0]+n_always[1]);
+	    YbarA /= *rb ? n_type[2] : (double)(n_always[0]+n_always[1]);
 	} else {
 	  ITT /= (double)n_samp;     /* ITT effect */
 	  Y1barC /= (double)n_samp;
@@ -2297,6 +3309,7 @@ void LItwopart(int *Y,      /* indicator variable; Y > 0 */
 	    YbarA /= (double)n_samp;
 	}
 	CACE = Y1barC-Y0barC;    /* CACE */
+	ProfPhase(PROF_STORE);
 
 	QoI[itempQ++] = ITT;   
 	QoI[itempQ++] = CACE;   
@@ -2329,6 +3342,11 @@ void LItwopart(int *Y,      /* indicator variable; Y > 0 */
 	    for (j = 0; j < n_covR; j++)
 	      coefR[itempR++] = delta[j];
 	}
+	if (sink) { /* the storage holds the current draw only */
+	  SinkCommit(sink);
+	  itempA = 0; itempC = 0; itempO = 0; itempO1 = 0;
+	  itempQ = 0; itempR = 0; itempS = 0;
+	}
 	keep = 1;
       } else
 	keep++;
@@ -2357,6 +3375,14 @@ void LItwopart(int *Y,      /* indicator variable; Y > 0 */
 	R_FlushConsole(); 
       }
     }
+
+    /** checkpoint; the draws kept so far are written out first **/
+    if (ck && (main_loop % *ckevery == 0) && (main_loop < *n_gen)) {
+      n_done = main_loop;
+      SinkSync(sink);
+      CkptSave(ck);
+    }
+
     R_FlushConsole();
     R_CheckUserInterrupt();
   } /* end of Gibbs sampler */
@@ -2364,12 +3390,26 @@ void LItwopart(int *Y,      /* indicator variable; Y > 0 */
   /** write out the random seed **/
   PutRNGstate();
 
+  /** write out the profile **/
+  ProfAccept(acceptC, n_covC*2);
+  ProfAccept(acceptR, n_covR);
+  ProfWrite(profile);
+
+  /** close the output sink **/
+  if (sink)
+    SinkClose(sink);
+  if (ck)
+    CkptClose(ck);
+
   /** freeing memory **/
-  FreeMatrix(Xc, n_samp+n_covC);
-  FreeMatrix(Xo, n_samp+n_covO);
+  DesignClose(Dc);
+  if (DcA)
+    DesignClose(DcA);
+  DesignClose(Dr);
+  DesignClose(Do);
+  free(T);
   FreeMatrix(Xobs, n_obs+n_covO);
   FreeMatrix(Xobs1, n_samp1+n_covO);
-  FreeMatrix(Xr, n_samp+n_covR);
   FreeMatrix(mtemp, n_covO);
   free(Yobs);
   free(meano);
@@ -17,6 +17,7 @@
 #include "subroutines.h"
 #include "rand.h"
 #include "models.h"
+#include "samplers.h"
 
 /*
   Preparing the data
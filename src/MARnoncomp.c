@@ -6,7 +6,105 @@
 #include <R.h>
 #include "vector.h"
 #include "subroutines.h"
+#include "design.h"
 #include "rand.h"
+#include "samplers.h"
+#include "sink.h"
+#include "profile.h"
+#include "monitor.h"
+
+/* 
+   Draw of the outcome coefficients when the outcome model has a
+   smooth function of the dose.  Its levels f at the first n11 units
+   get a random-walk prior: f[0] with precision sprec[0] and each
+   increment f[c]-f[c-1] with precision sprec[c].  The precision of
+   (f, gamma) then has a tridiagonal block for f, which is factored
+   as a band matrix; only the Schur complement for the n_cov = K
+   coefficients of the design d is dense.  This takes O(n11 K^2)
+   instead of sweeping a dense matrix of order K+n11.  The draw is
+   scaled by sig2, which is drawn first under marginal data
+   augmentation as in the dense case.
+*/
+
+static void SmoothGibbs(colDesign *d, double *W, int n11, double *sprec,
+			double *gamma, double *f, int mda, int nu0,
+			double s0, double *sig2){
+  int i, j, k, n_cov = d->n_cov, n_samp = d->n_samp;
+  double dtemp;
+  double **SS = doubleMatrix(n_cov+1, n_cov+1);
+  double **S = doubleMatrix(n_cov, n_cov);
+  double **L = doubleMatrix(n_cov, n_cov);
+  double **Fb = doubleMatrix(n11, 2);   /* band of the f block */
+  double **M = doubleMatrix(n_cov, n11); /* its factor \ the cross block */
+  double *yg = doubleArray(n_cov);
+
+  DesignSS(d, W, SS);
+
+  /* the f block: the prior plus one obs for each level */
+  for (i = 0; i < n11; i++) {
+    Fb[i][0] = 1 + sprec[i] + (i+1 < n11 ? sprec[i+1] : 0);
+    Fb[i][1] = (i > 0) ? -sprec[i] : 0;
+    f[i] = W[i];
+  }
+  dcholBand(Fb, n11, 1);
+  solveBand(Fb, n11, 1, f, 0);
+  for (k = 0; k < n_cov; k++) {
+    for (i = 0; i < n11; i++)
+      M[k][i] = d->X[(size_t)k*n_samp+i];
+    solveBand(Fb, n11, 1, M[k], 0);
+  }
+
+  /* Schur complement for gamma and the forward solves */
+  for (j = 0; j < n_cov; j++) {
+    for (k = 0; k <= j; k++) {
+      dtemp = SS[j][k];
+      for (i = 0; i < n11; i++)
+	dtemp -= M[j][i]*M[k][i];
+      S[j][k] = S[k][j] = dtemp;
+    }
+    yg[j] = SS[j][n_cov];
+    for (i = 0; i < n11; i++)
+      yg[j] -= M[j][i]*f[i];
+  }
+  dcholdc(S, n_cov, L);
+  for (j = 0; j < n_cov; j++) {
+    for (k = 0; k < j; k++)
+      yg[j] -= L[j][k]*yg[k];
+    yg[j] /= L[j][j];
+  }
+
+  /* sig2 from the residual sum of squares */
+  if (mda) {
+    dtemp = SS[n_cov][n_cov];
+    for (i = 0; i < n11; i++)
+      dtemp -= f[i]*f[i];
+    for (j = 0; j < n_cov; j++)
+      dtemp -= yg[j]*yg[j];
+    *sig2 = (dtemp+s0)/rchisq((double)n_samp+nu0);
+  }
+
+  /* the draw: back substitution from the scaled normal deviates */
+  for (j = n_cov-1; j >= 0; j--) {
+    gamma[j] = yg[j] + sqrt(*sig2)*norm_rand();
+    for (k = j+1; k < n_cov; k++)
+      gamma[j] -= L[k][j]*gamma[k];
+    gamma[j] /= L[j][j];
+  }
+  for (i = 0; i < n11; i++) {
+    f[i] += sqrt(*sig2)*norm_rand();
+    for (k = 0; k < n_cov; k++)
+      f[i] -= M[k][i]*gamma[k];
+  }
+  solveBand(Fb, n11, 1, f, 1);
+
+  FreeMatrix(SS, n_cov+1);
+  FreeMatrix(S, n_cov);
+  FreeMatrix(L, n_cov);
+  FreeMatrix(Fb, n11);
+  FreeMatrix(M, n_cov);
+  free(yg);
+} /* end of SmoothGibbs */
+
 
 void MARprobit(int *Y, /* binary outcome variable */ 
 	       int *Ymiss, /* missingness indicator for Y */
@@ -14,17 +112,29 @@ void MARprobit(int *Y, /* binary outcome variable */
 	       int *Z, /* treatment assignment */
 	       int *D, /* treatment status */ 
 	       int *C, /* compliance status */
-	       double *dX, double *dXo, /* covariates */
+	       double *dX, double *dXo, /* covariates; the column of dXo
+					   for compliers without treatment
+					   (C) is overwritten */
 	       double *dBeta, double *dGamma,    /* coefficients */
 	       int *iNsamp, int *iNgen, int *iNcov, int *iNcovo,
 	       int *iNcovoX, int *iN11, 
 	       /* counters */
 	       double *beta0, double *gamma0, double *dA, double *dAo, /*prior */
+	       double *dSprec, /* random-walk precisions of the smooth
+				  terms */
 	       int *insample, /* 1: insample inference, 2: conditional inference */
 	       int *smooth,   
 	       int *param, int *mda, int *iBurnin, 
 	       int *iKeep, int *verbose, /* options */
-	       double *pdStore
+	       int *online,   /* summarize kept draws instead of storing them? */
+	       int *single,   /* store the covariates as float? */
+	       double *ess,   /* stop once the effective sample size of
+				 each QoI is ess or more; 0 for never */
+	       double *rhat,  /* and its split R-hat is rhat or less */
+	       double *pdStore,
+	       double *summary, /* summaries of kept draws when online */
+	       double *profile, /* time spent in each phase and counters */
+	       double *conv     /* why and when the sampler stopped */
 	       ) {
   
   /*** counters ***/
@@ -35,10 +145,11 @@ void MARprobit(int *Y, /* binary outcome variable */
   int n_covoX = *iNcovoX; /* number of covariates excluding smooth
 			     terms */
   int n11 = *iN11;        /* number of compliers in the treament group */
+  int n_covoD = *smooth ? n_covoX : n_covo; /* # of columns of dXo */
   
-  /*** data ***/
-  double **X;     /* covariates for the compliance model */
-  double **Xo;    /* covariates for the outcome model */
+  /*** data: read in place ***/
+  colDesign *Dc;  /* covariates for the compliance model */
+  colDesign *Do;  /* covariates for the outcome model */
   double *W;      /* latent variable */
   int Ymax = *iYmax;
 
@@ -60,8 +171,6 @@ void MARprobit(int *Y, /* binary outcome variable */
   double **V;     /* variances for beta and gamma */
   double **Vo;
   double **Vr;
-  double **A;
-  double **Ao;
   double *tau;    /* thresholds: tau_0, ..., tau_{Ymax-1} */
   double *taumax; /* corresponding max and min for tau */
   double *taumin; /* tau_0 is fixed to 0 */
@@ -75,11 +184,14 @@ void MARprobit(int *Y, /* binary outcome variable */
   /*** storage parameters and loop counters **/
   int progress = 1;
   int keep = 1;
-  int i, j, k, main_loop;  
+  int i, j, k, main_loop;
   int itemp, itempP = ftrunc((double) n_gen/10);
   double dtemp, ndraw, cdraw;
   double *vtemp;
-  double **mtemp, **mtempo;
+  drawSink *sink = NULL;  /* summarizes the kept draws when online */
+  convMonitor *mon = NULL; /* convergence monitor of the QoIs */
+  int stopped = 0;        /* have the convergence targets been met? */
+  int n_qoi = (Ymax == 1) ? 6 : 2*(Ymax+1)+1;  /* # of QoIs */
 
   /*** marginal data augmentation ***/
   double sig2 = 1;
@@ -91,8 +203,6 @@ void MARprobit(int *Y, /* binary outcome variable */
 
 
   /*** define vectors and matricies **/
-  X = doubleMatrix(n_samp+n_cov, n_cov+1);
-  Xo = doubleMatrix(n_samp+n_covo, n_covo+1);
   W = doubleArray(n_samp);
   tau = doubleArray(Ymax);
   taumax = doubleArray(Ymax);
@@ -112,60 +222,26 @@ void MARprobit(int *Y, /* binary outcome variable */
   q = doubleArray(n_samp); 
   pc = doubleArray(n_samp); 
   pn = doubleArray(n_samp); 
-  A = doubleMatrix(n_cov, n_cov);
-  Ao = doubleMatrix(n_covo, n_covo);
   vtemp = doubleArray(n_samp);
-  mtemp = doubleMatrix(n_cov, n_cov);
-  mtempo = doubleMatrix(n_covo, n_covo);
   ITTc = doubleArray(Ymax+1);
-  treat = doubleArray(n11);
+  treat = doubleArray(n_samp);
   base = doubleArray(2);
 
-  /*** read the data ***/
-  itemp = 0;
-  for (j =0; j < n_cov; j++)
-    for (i = 0; i < n_samp; i++)
-      X[i][j] = dX[itemp++];
-
-  itemp = 0;
-  for (j =0; j < n_covo; j++)
-    for (i = 0; i < n_samp; i++)
-      Xo[i][j] = dXo[itemp++];
-  
-  /*** read the prior and it as additional data points ***/ 
-  itemp = 0;
-  for (k = 0; k < n_cov; k++)
-    for (j = 0; j < n_cov; j++)
-      A[j][k] = dA[itemp++];
-
-  itemp = 0;
-  for (k = 0; k < n_covo; k++)
-    for (j = 0; j < n_covo; j++)
-      Ao[j][k] = dAo[itemp++];
-
-  dcholdc(A, n_cov, mtemp);
-  for(i = 0; i < n_cov; i++) {
-    X[n_samp+i][n_cov]=0;
-    for(j = 0; j < n_cov; j++) {
-      X[n_samp+i][n_cov] += mtemp[i][j]*beta0[j];
-      X[n_samp+i][j] = mtemp[i][j];
-    }
-  }
-
-  dcholdc(Ao, n_covo, mtempo);
-  for(i = 0; i < n_covo; i++) {
-    Xo[n_samp+i][n_covo]=0;
-    for(j = 0; j < n_covo; j++) {
-      Xo[n_samp+i][n_covo] += mtempo[i][j]*gamma0[j];
-      Xo[n_samp+i][j] = mtempo[i][j];
-    }
-  }
+  /*** the data and the prior ***/
+  Dc = DesignOpen(dX, n_samp, n_cov, n_cov, NULL, 0, NULL, NULL, NULL,
+		  NULL, dA, beta0, *single);
+  Do = DesignOpen(dXo, n_samp, n_covoD, n_covoD, NULL, 0, NULL, NULL,
+		  NULL, NULL, dAo, gamma0, *single);
 
   /*** starting values ***/
   for (i = 0; i < n_cov; i++) 
     beta[i] = dBeta[i];
   for (i = 0; i < n_covo; i++)
     gamma[i] = dGamma[i];
+  /* the smooth terms start from the levels given by the increments */
+  if (*smooth)
+    for (i = 0; i < n11; i++)
+      treat[i] = (i > 0 ? treat[i-1] : 0) + dGamma[n_covoX+i];
   
   if (Ymax > 1) {
     tau[0] = 0.0;
@@ -179,44 +255,51 @@ void MARprobit(int *Y, /* binary outcome variable */
     pn[i] = unif_rand();
   }
 
+  /*** summarize the kept draws? pdStore then holds one draw ***/
+  if (*online) {
+    sink = SinkSummary(summary);
+    itemp = n_qoi;
+    if (*param)
+      itemp += n_cov + n_covo + (Ymax > 1 ? Ymax : 0);
+    pdStore = SinkBlock(sink, "par", itemp);
+    SinkStart(sink);
+  }
+
+  /*** stop early once the QoIs have converged? ***/
+  if (*ess > 0)
+    mon = MonOpen(n_qoi, *ess, *rhat);
+
   /*** Gibbs Sampler! ***/
+  ProfReset();
   itemp=0;     
-  for(main_loop = 1; main_loop <= n_gen; main_loop++){
+  for(main_loop = 1; main_loop <= n_gen && !stopped; main_loop++){
 
     /** COMPLIANCE MODEL **/    
+    ProfPhase(PROF_COMPLIANCE);
     if (*mda) sig2 = s0/rchisq((double)nu0);
     /* Draw complier status for control group */
+    DesignXBeta(Dc, 0, n_cov, beta, W);
     for(i = 0; i < n_samp; i++){
-      dtemp = 0;
-      for(j = 0; j < n_cov; j++) 
-	dtemp += X[i][j]*beta[j];
+      dtemp = W[i];
       if(Z[i] == 0){
 	q[i] = pnorm(dtemp, 0, 1, 1, 0);
-	if(unif_rand() < (q[i]*pc[i]/(q[i]*pc[i]+(1-q[i])*pn[i]))) { 
-	  C[i] = 1; Xo[i][1] = 1; 
-	}
-	else {
-	  C[i] = 0; Xo[i][1] = 0;
-	}
+	if(unif_rand() < (q[i]*pc[i]/(q[i]*pc[i]+(1-q[i])*pn[i])))
+	  C[i] = 1;
+	else
+	  C[i] = 0;
+	dXo[(*smooth ? 0 : n_samp)+i] = C[i];
       }
       /* Sample W */
       if(C[i]==0) 
 	W[i] = TruncNorm(dtemp-100,0,dtemp,1,0);
       else 
 	W[i] = TruncNorm(0,dtemp+100,dtemp,1,0);
-      X[i][n_cov] = W[i]*sqrt(sig2);
       W[i] *= sqrt(sig2);
     }
+    DesignColumn(Do, *smooth ? 0 : 1);
 
-    /* SS matrix */
-    for(j = 0; j <= n_cov; j++)
-      for(k = 0; k <= n_cov; k++)
-	SS[j][k]=0;
-    for(i = 0; i < n_samp+n_cov; i++)
-      for(j = 0; j <= n_cov; j++)
-	for(k = 0; k <= n_cov; k++) 
-	  SS[j][k] += X[i][j]*X[i][k];
     /* SWEEP SS matrix */
+    DesignSS(Dc, W, SS);
     for(j = 0; j < n_cov; j++)
       SWP(SS, j, n_cov+1);
     /* draw beta */    
@@ -234,6 +317,7 @@ void MARprobit(int *Y, /* binary outcome variable */
     }
 
     /** OUTCOME MODEL **/
+    ProfPhase(PROF_OUTCOME);
     /* Sample W */
     if (Ymax > 1) { /* tau_0=0, tau_1, ... */
       for (j = 1; j < (Ymax - 1); j++) {
@@ -244,9 +328,12 @@ void MARprobit(int *Y, /* binary outcome variable */
       taumin[Ymax-1] = tau[Ymax-2];
     }
     if (*mda) sig2 = s0/rchisq((double)nu0);
+    DesignXBeta(Do, 0, n_covoD, gamma, W);
+    if (*smooth)
+      for (i = 0; i < n11; i++)
+	W[i] += treat[i];
     for (i = 0; i < n_samp; i++){
-      dtemp = 0;
-      for (j = 0; j < n_covo; j++) dtemp += Xo[i][j]*gamma[j];
+      dtemp = W[i];
       if (Ymiss[i] == 1) {
 	W[i] = dtemp + norm_rand();
 	if (Ymax == 1) { /* binary probit */
@@ -282,57 +369,49 @@ void MARprobit(int *Y, /* binary outcome variable */
 	  }
 	}
       }
-      Xo[i][n_covo] = W[i]*sqrt(sig2);
       W[i] *= sqrt(sig2);
     }
     /* draw tau */
     if (Ymax > 1) 
       for (j = 1; j < Ymax; j++) 
 	tau[j] = runif(taumin[j], taumax[j])*sqrt(sig2);
-    /* SS matrix */
-    for(j = 0; j <= n_covo; j++)
-      for(k = 0; k <= n_covo; k++)
-	SSo[j][k]=0;
-    for(i = 0;i < n_samp+n_covo; i++)
-      for(j = 0;j <= n_covo; j++)
-	for(k = 0; k <= n_covo; k++) 
-	  SSo[j][k] += Xo[i][j]*Xo[i][k];
-    /* SWEEP SS matrix */
-    for(j = 0; j < n_covo; j++)
-      SWP(SSo, j, n_covo+1);
+    if (*smooth) {
+      /* the smooth terms and gamma in one banded draw */
+      SmoothGibbs(Do, W, n11, dSprec, gamma, treat, *mda, nu0, s0, &sig2);
+      if (*mda)
+	for (i = 0; i < n11; i++)
+	  treat[i] /= sqrt(sig2);
+    }
+    else {
+      /* SWEEP SS matrix */
+      DesignSS(Do, W, SSo);
+      for(j = 0; j < n_covo; j++)
+	SWP(SSo, j, n_covo+1);
 
-    /* draw gamma */    
-    for(j = 0; j < n_covo; j++)
-      meano[j] = SSo[j][n_covo];
-    if (*mda) 
-      sig2=(SSo[n_covo][n_covo]+s0)/rchisq((double)n_samp+nu0);
-    for(j = 0; j < n_covo; j++)
-      for(k = 0; k < n_covo; k++) Vo[j][k]=-SSo[j][k]*sig2;
-    rMVN(gamma, meano, Vo, n_covo); 
+      /* draw gamma */    
+      for(j = 0; j < n_covo; j++)
+	meano[j] = SSo[j][n_covo];
+      if (*mda) 
+	sig2=(SSo[n_covo][n_covo]+s0)/rchisq((double)n_samp+nu0);
+      for(j = 0; j < n_covo; j++)
+	for(k = 0; k < n_covo; k++) Vo[j][k]=-SSo[j][k]*sig2;
+      rMVN(gamma, meano, Vo, n_covo); 
+    }
     
     /* rescaling the parameters */
     if(*mda) {
-      for (i = 0; i < n_covo; i++) gamma[i] /= sqrt(sig2);
+      for (i = 0; i < n_covoD; i++) gamma[i] /= sqrt(sig2);
       if (Ymax > 1)
 	for (i = 1; i < Ymax; i++)
 	  tau[i] /= sqrt(sig2);
     }
 
-    /* computing smooth terms */
-    if (*smooth) {
-      for (i = 0; i < n11; i++) {
-	treat[i] = 0;
-	for (j = n_covoX; j < n_covo; j++)
-	  treat[i] += Xo[i][j]*gamma[j]; 
-      }
-    }
-
     /** Compute probabilities **/ 
-    for(i = 0; i < n_samp; i++){
-      vtemp[i] = 0;
-      for(j = 0; j < n_covo; j++)
-	vtemp[i] += Xo[i][j]*gamma[j];
-    }
+    ProfPhase(PROF_PROB);
+    DesignXBeta(Do, 0, n_covoD, gamma, vtemp);
+    if (*smooth)
+      for (i = 0; i < n11; i++)
+	vtemp[i] += treat[i];
 
     for(i = 0; i < n_samp; i++){
       if(Z[i]==0){
@@ -376,6 +455,7 @@ void MARprobit(int *Y, /* binary outcome variable */
     }
 
     /** Compute quantities of interest **/
+    ProfPhase(PROF_QOI);
     n_comp = 0; n_compC = 0; n_ncompC = 0; base[0] = 0; base[1] = 0; 
     for (i = 0; i <= Ymax; i++)
       ITTc[i] = 0;
@@ -503,6 +583,7 @@ void MARprobit(int *Y, /* binary outcome variable */
     }
     
     /** storing the results **/
+    ProfPhase(PROF_STORE);
     if (main_loop > *iBurnin) {
       if (keep == *iKeep) {
 	pdStore[itemp++]=(double)n_comp/(double)n_samp;
@@ -519,6 +600,8 @@ void MARprobit(int *Y, /* binary outcome variable */
 	  for (i = 0; i <= Ymax; i++) 
 	    pdStore[itemp++]=ITTc[i]/(double)n_samp;
 	}
+	if (mon)
+	  stopped = MonAdd(mon, pdStore + itemp - n_qoi);
 	if (*param) {
 	  for(i = 0; i < n_cov; i++) 
 	    pdStore[itemp++]=beta[i];
@@ -535,6 +618,10 @@ void MARprobit(int *Y, /* binary outcome variable */
 	    for (i = 0; i < Ymax; i++)
 	      pdStore[itemp++]=tau[i];
 	}
+	if (sink) {
+	  SinkCommit(sink);
+	  itemp = 0;
+	}
 	keep = 1;
       }
       else
@@ -556,9 +643,26 @@ void MARprobit(int *Y, /* binary outcome variable */
   /** write out the random seed **/
   PutRNGstate();
 
+  /** write out the profile **/
+  ProfWrite(profile);
+
+  /** write out the convergence status **/
+  if (mon) {
+    MonWrite(mon, stopped, main_loop-1, conv);
+    if (*verbose)
+      Rprintf("%s after %d iterations; smallest ESS %g, largest R-hat %g.\n",
+	      stopped ? "Converged" : "Not converged", main_loop-1,
+	      mon->min_ess, mon->max_rhat);
+    MonClose(mon);
+  }
+
+  /** write out the summaries **/
+  if (sink)
+    SinkClose(sink);
+
   /** freeing memory **/
-  FreeMatrix(X, n_samp+n_cov);
-  FreeMatrix(Xo, n_samp+n_covo);
+  DesignClose(Dc);
+  DesignClose(Do);
   free(W);
   free(beta);
   free(gamma);
@@ -573,8 +677,6 @@ void MARprobit(int *Y, /* binary outcome variable */
   FreeMatrix(V, n_cov);
   FreeMatrix(Vo, n_covo);
   FreeMatrix(Vr, 3);
-  FreeMatrix(A, n_cov);
-  FreeMatrix(Ao, n_covo);
   free(tau);
   free(taumax);
   free(taumin);
@@ -582,8 +684,6 @@ void MARprobit(int *Y, /* binary outcome variable */
   free(vtemp);
   free(treat);
   free(base);
-  FreeMatrix(mtemp, n_cov);
-  FreeMatrix(mtempo, n_covo);
 
 } /* main */
 
@@ -8,15 +8,111 @@
 #include "subroutines.h"
 #include "rand.h"
 #include "models.h"
+#include "samplers.h"
+#include "sink.h"
+#include "profile.h"
+#include "monitor.h"
 
 /* 
    Bayesian Binary Probit with Nonignorable Missing Outcomes 
+
+   With compress = 1, the units are collapsed into the patterns of
+   (Xo, Xr, R, Y) given by R: Y then holds the # of ones among the
+   count units of each pattern, and the imputed # of ones of a pattern
+   with missing outcomes is drawn from the binomial distribution.  The
+   response model has one row per pattern, with Y = 0 for those with
+   missing outcomes, followed by a row with Y = 1 for each of them;
+   their weights are the # of units imputed to be zeros and ones.
+   This reduces the passes over the designs (X'WX, X'W and the linear
+   predictors) to one per pattern.  The latent variables enter only
+   through their sums and sums of squares per pattern, which are drawn
+   directly for patterns of many units (see bprobitLatent), so an
+   iteration costs O(patterns * p) regardless of N.
+
+   The latent variables of both models, the imputation of Y, and the
+   QoIs are computed by one pass over the units (NIpass), which reads
+   the linear predictors computed once after each draw of the
+   coefficients.  An imputed Y changes only its own row of (1-Y, Y)
+   in Xr, so X'X of the response model is updated row by row unless
+   Xr has sparse columns.
 */
 
+static void NIpass(int *Y, int *R, int *count, double *dXo, double *dXr,
+		   colDesign *Do, colDesign *Dr, double *beta,
+		   double *delta, double *eta, double *etar, int n_treat,
+		   int compress, int insample, double sig2o, double sig2r,
+		   double *Wo, double *Wr, double *WWo, double *WWr,
+		   double *base) {
+  int i, j, m, n_pat, y0, n_samp = Do->n_samp, n_rowr = Dr->n_samp;
+  int incr = (Dr->n_dense == Dr->n_cov), imputed = 0;
+  double pj, r0, r1, dtemp;
+
+  *WWo = 0; *WWr = 0;
+  for (j = 0; j < n_treat; j++)
+    base[j] = 0;
+  for (i = 0, m = n_samp; i < n_samp; i++) {
+    n_pat = compress ? count[i] : 1;
+    /* imputation given the response model without (1-Y, Y) */
+    if (R[i] == 0) {
+      dtemp = etar[i] - delta[0]*dXr[i] - delta[1]*dXr[n_rowr+i];
+      pj = pnorm(0, eta[i], 1, 0, 0);
+      r0 = pnorm(0, delta[0]+dtemp, 1, 0, 0);
+      r1 = pnorm(0, delta[1]+dtemp, 1, 0, 0);
+      pj = (1-r1)*pj/((1-r1)*pj+(1-r0)*(1-pj));
+      y0 = Y[i];
+      if (n_pat == 1)
+	Y[i] = (unif_rand() < pj);
+      else
+	Y[i] = (int)rbinom((double)n_pat, pj);
+      if (compress) {
+	DesignRowWeight(Dr, i, n_pat - Y[i]);
+	DesignRowWeight(Dr, m, Y[i]);
+	Wr[m] = bprobitLatent(etar[m], Y[i], 0, sig2r, WWr);
+	m++;
+      } else if (Y[i] != y0) {
+	etar[i] += (Y[i] - y0)*(delta[1] - delta[0]);
+	if (incr) {
+	  DesignSetElt(Dr, i, 0, 1 - Y[i]);
+	  DesignSetElt(Dr, i, 1, Y[i]);
+	} else {
+	  dXr[i] = 1 - Y[i];
+	  dXr[n_rowr+i] = Y[i];
+	  imputed = 1;
+	}
+      }
+    }
+    /* latent variables for the next draws of the coefficients */
+    Wo[i] = bprobitLatent(eta[i], n_pat, Y[i], sig2o, WWo);
+    Wr[i] = bprobitLatent(etar[i], Dr->w ? (int)Dr->w[i] : 1,
+			  compress ? R[i]*count[i] : R[i], sig2r, WWr);
+    /* QoIs */
+    dtemp = eta[i];
+    for (j = 0; j < n_treat; j++)
+      dtemp -= beta[j]*dXo[i+(size_t)j*n_samp];
+    for (j = 0; j < n_treat; j++) {
+      if (insample) {
+	if (dXo[i+(size_t)j*n_samp] == 1)
+	  base[j] += (double)Y[i];
+	else if (n_pat == 1)
+	  base[j] += (double)((dtemp+beta[j]+norm_rand()) > 0);
+	else
+	  base[j] += rbinom((double)n_pat, pnorm(0, dtemp+beta[j], 1, 0, 0));
+      } else
+	base[j] += n_pat*pnorm(0, dtemp+beta[j], 1, 0, 0);
+    }
+  }
+  if (imputed) {
+    DesignColumn(Dr, 0);
+    DesignColumn(Dr, 1);
+  }
+} /* end of NIpass */
+
+
 void NIbprobit(int *Y,         /* binary outcome variable */ 
 	       int *R,         /* recording indicator for Y */
 	       double *dXo,    /* covariates */
-	       double *dXr,    /* covariates */
+	       double *dXr,    /* covariates; (1-Y, Y) are overwritten
+				  unless compress = 1 */
 	       double *beta,   /* coefficients */
 	       double *delta,  /* coefficients */
 	       int *insamp,    /* # of obs */ 
@@ -34,10 +130,30 @@ void NIbprobit(int *Y,         /* binary outcome variable */
 	       int *iBurnin,   /* # of burnin */
 	       int *iKeep,     /* every ?th draws to keep */
 	       int *verbose,  
+	       int *online,    /* summarize kept draws instead of
+				  storing them? */
+	       int *single,    /* store the covariates as float? */
+	       int *sparse,    /* covariates other than the treatments
+				  (dXo) and outcomes (dXr) passed as
+				  compressed sparse columns? */
+	       int *spo_p,     /* sparse covariates: column pointers, */
+	       int *spo_i,     /* row indices, */
+	       double *spo_x,  /* and values */
+	       int *spr_p,
+	       int *spr_i,
+	       double *spr_x,
+	       int *compress,  /* units collapsed into patterns? */
+	       int *count,     /* # of units in each pattern */
+	       double *ess,    /* stop once the effective sample size of
+				  each QoI is ess or more; 0 for never */
+	       double *rhat,   /* and its split R-hat is rhat or less */
 	       double *coefo,  /* storage for coefficients */ 
 	       double *coefr,  /* storage for coefficients */ 
 	       double *ATE,     /* storage for ATE */
-	       double *BASE    /* storage for baseline */
+	       double *BASE,   /* storage for baseline */
+	       double *summary,/* summaries of kept draws when online */
+	       double *profile,/* time spent in each phase and counters */
+	       double *conv    /* why and when the sampler stopped */
 	       ) {
   
   /*** counters ***/
@@ -46,18 +162,18 @@ void NIbprobit(int *Y,         /* binary outcome variable */
   int n_covo = *incovo;      /* number of covariates */
   int n_covr = *incovr;      /* number of covariates */
   int n_treat = *intreat;    /* number of treatments */
-
-  /*** data ***/
-  /* covariates for the response model */
-  double **Xr = doubleMatrix(n_samp+n_covr, n_covr+1);
-  /* covariates for the outcome model */     
-  double **Xo = doubleMatrix(n_samp+n_covo, n_covo+1);
-
-  /*** model parameters ***/
-  double **Ao = doubleMatrix(n_covo, n_covo);
-  double **Ar = doubleMatrix(n_covr, n_covr);
-  double **mtemp1 = doubleMatrix(n_covo, n_covo);
-  double **mtemp2 = doubleMatrix(n_covr, n_covr);
+  int n_rowr = n_samp;       /* # of rows in the response model */
+  int n_unit = n_samp;       /* # of units */
+
+  /*** data: read in place; the first two columns of dXr (1-Y, Y)
+       are overwritten when Y is imputed ***/
+  colDesign *Dr;             /* covariates for the response model */
+  colDesign *Do;             /* covariates for the outcome model */
+  double *eta, *etar;        /* linear predictors */
+  double *Wo, *Wr;           /* latent variables, summed by rows */
+  double WWo, WWr;           /* and their sums of squares */
+  double *wo = NULL;         /* # of units in each row */
+  double *wr = NULL;
 
   /*** QoIs ***/
   double *base = doubleArray(n_treat);
@@ -66,122 +182,131 @@ void NIbprobit(int *Y,         /* binary outcome variable */
   /*** storage parameters and loop counters **/
   int progress = 1;
   int keep = 1;
-  int i, j, k, main_loop;  
+  int i, j, m, main_loop;
   int itemp, itemp0, itemp1, itemp2, itempP = ftrunc((double) n_gen/10);
-  double dtemp, pj, r0, r1;
+  drawSink *sink = NULL;     /* summarizes the kept draws when online */
+  convMonitor *mon = NULL;   /* convergence monitor of ATE and base */
+  double *qoi = NULL;
+  int stopped = 0;           /* have the convergence targets been met? */
+
+  /*** marginal data augmentation ***/
+  double sig2o = 1, sig2r = 1;
+  int nu0 = 1;
+  double s0 = 1;
 
   /*** get random seed **/
   GetRNGstate();
 
-  /*** read the data ***/
-  itemp = 0;
-  for (j = 0; j < n_covo; j++)
-    for (i = 0; i < n_samp; i++) 
-      Xo[i][j] = dXo[itemp++];
-  itemp = 0;
-  for (j = 0; j < n_covr; j++)
-    for (i = 0; i < n_samp; i++) 
-      Xr[i][j] = dXr[itemp++];
-  
-  /*** read the prior and it as additional data points ***/ 
-  itemp = 0;
-  for (k = 0; k < n_covo; k++)
-    for (j = 0; j < n_covo; j++)
-      Ao[j][k] = dAo[itemp++];
-
-  itemp = 0;
-  for (k = 0; k < n_covr; k++)
-    for (j = 0; j < n_covr; j++)
-      Ar[j][k] = dAr[itemp++];
-
-  dcholdc(Ao, n_covo, mtemp1);
-  for(i = 0; i < n_covo; i++) {
-    Xo[n_samp+i][n_covo] = 0;
-    for(j = 0; j < n_covo; j++) {
-      Xo[n_samp+i][n_covo] += mtemp1[i][j]*beta0[j];
-      Xo[n_samp+i][j] = mtemp1[i][j];
+  /*** the data and the prior ***/
+  if (*compress) {
+    for (i = 0; i < n_samp; i++)
+      if (R[i] == 0)
+	n_rowr++;
+    wo = doubleArray(n_samp);
+    wr = doubleArray(n_rowr);
+    n_unit = 0;
+    for (i = 0, m = n_samp; i < n_samp; i++) {
+      n_unit += count[i];
+      wo[i] = count[i];
+      if (R[i] == 0) {
+	wr[i] = count[i] - Y[i];
+	wr[m++] = Y[i];
+      } else
+	wr[i] = count[i];
     }
   }
-
-  dcholdc(Ar, n_covr, mtemp2);
-  for(i = 0; i < n_covr; i++) {
-    Xr[n_samp+i][n_covr] = 0;
-    for(j = 0; j < n_covr; j++) {
-      Xr[n_samp+i][n_covr] += mtemp2[i][j]*delta0[j];
-      Xr[n_samp+i][j] = mtemp2[i][j];
+  eta = doubleArray(n_rowr);
+  etar = doubleArray(n_rowr);
+  Wo = doubleArray(n_samp);
+  Wr = doubleArray(n_rowr);
+  Do = DesignOpen(dXo, n_samp, n_covo, *sparse ? n_treat : n_covo,
+		  NULL, 0, spo_p, spo_i, spo_x, wo, dAo, beta0, *single);
+  Dr = DesignOpen(dXr, n_rowr, n_covr, *sparse ? 2 : n_covr,
+		  NULL, 0, spr_p, spr_i, spr_x, wr, dAr, delta0, *single);
+
+  /*** summarize the kept draws? the storage then holds one draw ***/
+  if (*online) {
+    sink = SinkSummary(summary);
+    ATE = SinkBlock(sink, "ATE", n_treat-1);
+    BASE = SinkBlock(sink, "base", n_treat);
+    if (*param) {
+      coefo = SinkBlock(sink, "coefO", n_covo);
+      coefr = SinkBlock(sink, "coefR", n_covr);
     }
+    SinkStart(sink);
+  }
+
+  /*** stop early once the QoIs have converged? ***/
+  if (*ess > 0) {
+    mon = MonOpen(2*n_treat-1, *ess, *rhat);
+    qoi = doubleArray(2*n_treat-1);
   }
 
   /*** Gibbs Sampler! ***/
+  ProfReset();
   itemp = 0; itemp0 = 0; itemp1 = 0; itemp2 = 0;     
-  for(main_loop = 1; main_loop <= n_gen; main_loop++){
+  /* Y imputed and the latent variables drawn given the starting values */
+  ProfPhase(PROF_LATENT);
+  DesignXBeta(Do, 0, n_covo, beta, eta);
+  DesignXBeta(Dr, 0, n_covr, delta, etar);
+  if (*mda) {
+    sig2o = s0/rchisq((double)nu0);
+    sig2r = s0/rchisq((double)nu0);
+  }
+  NIpass(Y, R, count, dXo, dXr, Do, Dr, beta, delta, eta, etar, n_treat,
+	 *compress, *Insample, sig2o, sig2r, Wo, Wr, &WWo, &WWr, base);
+  for(main_loop = 1; main_loop <= n_gen && !stopped; main_loop++){
 
     /** Response Model: binary Probit **/    
-    bprobitGibbs(R, Xr, delta, n_samp, n_covr, 0, delta0, Ar, *mda, 1);
+    ProfPhase(PROF_RESPONSE);
+    bprobitDrawCol(Dr, Wr, WWr, n_unit, delta, *mda, sig2r);
+    DesignXBeta(Dr, 0, n_covr, delta, etar);
       
     /** Outcome Model: binary probit **/
-    bprobitGibbs(Y, Xo, beta, n_samp, n_covo, 0, beta0, Ao, *mda, 1);
-
-    /** Imputing the missing data **/
-    for (i = 0; i < n_samp; i++) {
-      if (R[i] == 0) {
-	pj = 0;
-	r0 = delta[0];
-	r1 = delta[1];
-	for (j = 0; j < n_covo; j++) 
-	  pj += Xo[i][j]*beta[j];
-	for (j = 2; j < n_covr; j++) {
-	  r0 += Xr[i][j]*delta[j];
-	  r1 += Xr[i][j]*delta[j];
-	}
-	pj = pnorm(0, pj, 1, 0, 0);
-	r0 = pnorm(0, r0, 1, 0, 0);
-	r1 = pnorm(0, r1, 1, 0, 0);
-	if (unif_rand() < ((1-r1)*pj/((1-r1)*pj+(1-r0)*(1-pj)))) {
-	  Y[i] = 1;
-	  Xr[i][0] = 0;
-	  Xr[i][1] = 1;
-	} else {
-	  Y[i] = 0;
-	  Xr[i][0] = 1;
-	  Xr[i][1] = 0;
-	} 
-      }
+    ProfPhase(PROF_OUTCOME);
+    bprobitDrawCol(Do, Wo, WWo, n_unit, beta, *mda, sig2o);
+    DesignXBeta(Do, 0, n_covo, beta, eta);
+
+    /** Imputing the missing data, the latent variables, and the QoIs **/
+    ProfPhase(PROF_LATENT);
+    if (*mda) {
+      sig2o = s0/rchisq((double)nu0);
+      sig2r = s0/rchisq((double)nu0);
     }
+    NIpass(Y, R, count, dXo, dXr, Do, Dr, beta, delta, eta, etar, n_treat,
+	   *compress, *Insample, sig2o, sig2r, Wo, Wr, &WWo, &WWr, base);
     
     /** Compute quantities of interest **/
+    ProfPhase(PROF_QOI);
     for (j = 0; j < n_treat; j++) 
-      base[j] = 0;
-    for (i = 0; i < n_samp; i++) {
-      dtemp = 0; 
-      for (j = n_treat; j < n_covo; j++) 
-	dtemp += Xo[i][j]*beta[j];
-      for (j = 0; j < n_treat; j++) {
-	if (*Insample) {
-	  if (Xo[i][j] == 1)
-	    base[j] += (double)Y[i];
-	  else
-	    base[j] += (double)((dtemp+beta[j]+norm_rand()) > 0);
-	} else
-	  base[j] += pnorm(0, dtemp+beta[j], 1, 0, 0);
-      }
-    }
-    for (j = 0; j < n_treat; j++) 
-      base[j] /= (double)n_samp;
+      base[j] /= (double)n_unit;
     
     /** Storing the results **/
+    ProfPhase(PROF_STORE);
     if (main_loop > *iBurnin) {
       if (keep == *iKeep) {
 	for (j = 0; j < (n_treat-1); j++)
 	  ATE[itemp0++] = base[j+1] - base[0];
 	for (j = 0; j < n_treat; j++)
 	  BASE[itemp++] = base[j];
+	if (mon) {
+	  for (j = 0; j < n_treat; j++) {
+	    qoi[j] = base[j];
+	    if (j > 0)
+	      qoi[n_treat+j-1] = base[j] - base[0];
+	  }
+	  stopped = MonAdd(mon, qoi);
+	}
 	if (*param) {
 	  for (i = 0; i < n_covo; i++) 
 	    coefo[itemp1++] = beta[i];
 	  for (i = 0; i < n_covr; i++) 
 	    coefr[itemp2++] = delta[i];
 	}
+	if (sink) {
+	  SinkCommit(sink);
+	  itemp = 0; itemp0 = 0; itemp1 = 0; itemp2 = 0;
+	}
 	keep = 1;
       }
       else
@@ -202,13 +327,35 @@ void NIbprobit(int *Y,         /* binary outcome variable */
   /** write out the random seed **/
   PutRNGstate();
 
+  /** write out the profile **/
+  ProfWrite(profile);
+
+  /** write out the convergence status **/
+  if (mon) {
+    MonWrite(mon, stopped, main_loop-1, conv);
+    if (*verbose)
+      Rprintf("%s after %d iterations; smallest ESS %g, largest R-hat %g.\n",
+	      stopped ? "Converged" : "Not converged", main_loop-1,
+	      mon->min_ess, mon->max_rhat);
+    MonClose(mon);
+    free(qoi);
+  }
+
+  /** write out the summaries **/
+  if (sink)
+    SinkClose(sink);
+
   /** freeing memory **/
-  FreeMatrix(Xr, n_samp+n_covr);
-  FreeMatrix(Xo, n_samp+n_covo);
-  FreeMatrix(Ao, n_covo);
-  FreeMatrix(Ar, n_covr);
-  FreeMatrix(mtemp1, n_covo);
-  FreeMatrix(mtemp2, n_covr);
+  DesignClose(Dr);
+  DesignClose(Do);
+  free(eta);
+  free(etar);
+  free(Wo);
+  free(Wr);
+  if (*compress) {
+    free(wo);
+    free(wr);
+  }
   free(base);
   free(cATE);
 } /* NIbprobit */
@@ -304,7 +451,7 @@ void NIbprobitMixed(int *Y,         /* binary outcome variable */
   int progress = 1;
   int keep = 1;
   int i, j, k, main_loop;  
-  int itemp, itemp0, itemp1, itemp2, itemp3 = 0, itempP = ftrunc((double) n_gen/10);
+  int itemp, itemp0, itemp1, itemp2, itemp3 = 0, itemp4 = 0, itempP = ftrunc((double) n_gen/10);
   int *vitemp = intArray(n_grp);
   double dtemp, pj, r0, r1;
 
@@ -411,7 +558,7 @@ void NIbprobitMixed(int *Y,         /* binary outcome variable */
 		      1);
       
     /** Outcome Model: binary probit **/
-    bprobitMixedGibbs(Y, Xo, Zr, grp, beta, xiO, PsiO, n_samp, n_covo,
+    bprobitMixedGibbs(Y, Xo, Zo, grp, beta, xiO, PsiO, n_samp, n_covo,
 		      n_covoR, n_grp, 0, beta0, Ao, *dfo, S0o, 1);
 
     /** Imputing the missing data **/
@@ -492,7 +639,7 @@ void NIbprobitMixed(int *Y,         /* binary outcome variable */
 	      sPsiO[itemp3++] = PsiO[i][j];
 	  for (i = 0; i < n_covrR; i++)
 	    for (j = i; j < n_covrR; j++)
-	      sPsiR[itemp3++] = PsiR[i][j];
+	      sPsiR[itemp4++] = PsiR[i][j];
 	}
 	keep = 1;
       }
@@ -0,0 +1,311 @@
+/****
+
+     This file contains the bootstraps of the bounds with missing
+     outcomes: the sharp bounds on the ATE (ATEbounds) and, at the
+     end, the bounds on the ATOP under the matched-pairs design.  The
+     bounds on the ATE depend on the data
+     only through the weighted sums of the lower and upper imputations
+     of the outcome within each stratum and treatment group, so the
+     units are grouped in R into cells of identical (stratum,
+     treatment, imputations, survey weight) and each replicate only
+     draws the weights of the cells.
+
+     The replicates use the Poisson bootstrap: each unit gets an
+     independent Poisson(1) weight, so that the weight of a cell of c
+     units is one Poisson(c) draw.  The replicates are split among
+     threads; each has its own random number stream, seeded from R's
+     generator before the threads start, so that they do not depend
+     on the # of threads.
+
+     The point estimates aggregated over strata use the same statistic
+     on the sums accumulated by one pass over the units.
+
+****/
+
+#include <stdlib.h>
+#include <R.h>
+#include <Rmath.h>
+#include "vector.h"
+#include "rand.h"
+#include "samplers.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+/* The bounds from the sums within the strata and groups: sw, slo and
+   shi are J by M (column-major) sums of the weights and of the
+   weighted lower and upper imputations, and nw the sums of the
+   weights without the survey weights.  Unless agg, J = 1 and out has
+   the layout of boundsComp, the bounds within each group followed by
+   those on the ATE; otherwise, it has those of boundsAggComp with
+   alpha = NULL, the bounds on the ATE aggregated over the strata. */
+static void BoundsStat(double *sw, double *slo, double *shi, double *nw,
+		       int n_strata, int n_arm, double *ratio, int fix_ratio,
+		       int agg, double *out) {
+  int i, j, k, s, l = 0;
+  double lo, hi, om, tot, ntot = 0;
+
+  if (!agg) {
+    for (j = 0; j < n_arm; j++) {
+      out[l++] = slo[j]/sw[j];
+      out[l++] = shi[j]/sw[j];
+    }
+    for (j = 0; j < n_arm-1; j++)
+      for (k = j+1; k < n_arm; k++) {
+	out[l++] = slo[j]/sw[j] - shi[k]/sw[k];
+	out[l++] = shi[j]/sw[j] - slo[k]/sw[k];
+      }
+    return;
+  }
+
+  /* strata are weighted by their share of the two groups compared;
+     a stratum without units of either group is dropped */
+  if (!fix_ratio)
+    for (s = 0; s < n_strata*n_arm; s++)
+      ntot += nw[s];
+  for (j = 0; j < n_arm-1; j++)
+    for (k = j+1; k < n_arm; k++) {
+      lo = 0; hi = 0; tot = 0;
+      for (i = 0; i < n_strata; i++) {
+	if (fix_ratio)
+	  om = ratio[i+j*n_strata] + ratio[i+k*n_strata];
+	else
+	  om = (nw[i+j*n_strata] + nw[i+k*n_strata])/ntot;
+	if (om == 0)
+	  continue;
+	lo += om*(slo[i+j*n_strata]/sw[i+j*n_strata] -
+		  shi[i+k*n_strata]/sw[i+k*n_strata]);
+	hi += om*(shi[i+j*n_strata]/sw[i+j*n_strata] -
+		  slo[i+k*n_strata]/sw[i+k*n_strata]);
+	tot += om;
+      }
+      out[l++] = lo/tot;
+      out[l++] = hi/tot;
+    }
+} /* end of BoundsStat */
+
+
+void boundsBoot(int *arm,       /* treatment group of each cell: 0, ... */
+		int *stratum,   /* stratum of each cell: 0, ... */
+		int *count,     /* # of units in each cell */
+		double *Ymin,   /* lower imputation of the outcome */
+		double *Ymax,   /* upper imputation of the outcome */
+		double *survey, /* survey weight */
+		int *n_cell,    /* # of cells */
+		int *n_arm,     /* # of treatment groups */
+		int *n_strata,  /* # of strata */
+		double *ratio,  /* J by M probabilities of the strata and
+				   groups */
+		int *fix_ratio, /* use ratio rather than the replicate's
+				   shares? */
+		int *agg,       /* aggregate over the strata? */
+		int *n_reps,    /* # of replicates */
+		int *n_thread,  /* # of threads */
+		double *reps    /* n_reps by n_stat replicates */
+		) {
+  int r, n_pair = (*n_arm)*(*n_arm-1)/2, n_group = (*n_strata)*(*n_arm);
+  int n_stat = *agg ? 2*n_pair : 2*(*n_arm + n_pair);
+  int n_work = 4*n_group + n_stat;
+  rngStream *rs = (rngStream *)R_alloc(*n_reps, sizeof(rngStream));
+  /* scratch of each thread, allocated here since error() must not be
+     raised inside the parallel region */
+  double *work = doubleArray((*n_thread > 1 ? *n_thread : 1)*n_work);
+
+  GetRNGstate();
+  for (r = 0; r < *n_reps; r++)
+    StreamSeed(rs + r);
+  PutRNGstate();
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(*n_thread > 1 ? *n_thread : 1) \
+  if (*n_thread > 1)
+#endif
+  {
+    int c, g, k;
+    double w;
+#ifdef _OPENMP
+    double *sw = work + (size_t)omp_get_thread_num()*n_work;
+#else
+    double *sw = work;
+#endif
+    double *slo = sw + n_group, *shi = slo + n_group, *nw = shi + n_group;
+    double *out = nw + n_group;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (r = 0; r < *n_reps; r++) {
+      for (g = 0; g < n_group; g++) {
+	sw[g] = 0; slo[g] = 0; shi[g] = 0; nw[g] = 0;
+      }
+      for (c = 0; c < *n_cell; c++) {
+	w = (double)StreamPois(rs + r, (double)count[c]);
+	if (w == 0)
+	  continue;
+	g = stratum[c] + arm[c]*(*n_strata);
+	nw[g] += w;
+	w *= survey[c];
+	sw[g] += w;
+	slo[g] += w*Ymin[c];
+	shi[g] += w*Ymax[c];
+      }
+      BoundsStat(sw, slo, shi, nw, *n_strata, *n_arm, ratio, *fix_ratio,
+		 *agg, out);
+      for (k = 0; k < n_stat; k++)
+	reps[r+(size_t)k*(*n_reps)] = out[k];
+    }
+  }
+
+  free(work);
+} /* end of boundsBoot */
+
+
+/* The bounds aggregated over the strata (boundsAggComp) by one pass
+   over the units, which accumulates the sums of BoundsStat for each
+   stratum and group */
+void boundsAgg(int *arm,       /* treatment group of each unit: 0, ... */
+	       int *stratum,   /* stratum of each unit: 0, ... */
+	       double *Ymin,   /* lower imputation of the outcome */
+	       double *Ymax,   /* upper imputation of the outcome */
+	       double *weights,/* weight */
+	       double *survey, /* survey weight */
+	       int *n_samp,    /* # of units */
+	       int *n_arm,     /* # of treatment groups */
+	       int *n_strata,  /* # of strata */
+	       double *ratio,  /* J by M probabilities of the strata and
+				  groups; estimated unless fix_ratio */
+	       int *fix_ratio,
+	       double *bounds  /* bounds on the ATE for each pair */
+	       ) {
+  int i, g, n_group = (*n_strata)*(*n_arm);
+  double w, ntot = 0;
+  double *sw = doubleArray(n_group), *slo = doubleArray(n_group);
+  double *shi = doubleArray(n_group), *nw = doubleArray(n_group);
+
+  for (g = 0; g < n_group; g++) {
+    sw[g] = 0; slo[g] = 0; shi[g] = 0; nw[g] = 0;
+  }
+  for (i = 0; i < *n_samp; i++) {
+    g = stratum[i] + arm[i]*(*n_strata);
+    nw[g] += weights[i];
+    w = weights[i]*survey[i];
+    sw[g] += w;
+    slo[g] += w*Ymin[i];
+    shi[g] += w*Ymax[i];
+  }
+  if (!*fix_ratio) {
+    for (g = 0; g < n_group; g++)
+      ntot += nw[g];
+    for (g = 0; g < n_group; g++)
+      ratio[g] = nw[g]/ntot;
+  }
+  BoundsStat(sw, slo, shi, nw, *n_strata, *n_arm, ratio, 1, 1, bounds);
+
+  free(sw); free(slo); free(shi); free(nw);
+} /* end of boundsAgg */
+
+
+/* The sup of the two empirical CDFs of the B-method (see boundsCI) at
+   each of the 2R differences bmin and bmax: after sorting both, one
+   merge gives the # of differences of each kind below every value,
+   so that this costs O(R log R) rather than O(R^2).  The values of
+   bsup are in increasing order of the differences. */
+void boundsSup(double *bmin,  /* R lower bound differences */
+	       double *bmax,  /* R upper bound differences */
+	       int *n_reps,   /* R */
+	       double *bsup   /* 2R sups of the empirical CDFs */
+	       ) {
+  int i, a = 0, b = 0, n = *n_reps;
+  double x, v;
+  double *smin = doubleArray(n), *smax = doubleArray(n);
+
+  for (i = 0; i < n; i++) {
+    if (ISNAN(bmin[i]) || ISNAN(bmax[i]))
+      error("boundsSup: the differences should not be missing.\n");
+    smin[i] = bmin[i];
+    smax[i] = bmax[i];
+  }
+  R_rsort(smin, n);
+  R_rsort(smax, n);
+  /* the differences tied at x share its value */
+  for (i = 0; i < 2*n; ) {
+    x = (b >= n || (a < n && smin[a] <= smax[b])) ? smin[a] : smax[b];
+    while (a < n && smin[a] <= x)
+      a++;
+    while (b < n && smax[b] <= x)
+      b++;
+    v = (double)(a > b ? a : b)/n;
+    while (i < a+b)
+      bsup[i++] = v;
+  }
+
+  free(smin);
+  free(smax);
+} /* end of boundsSup */
+
+
+/* The bootstrap of the ATOP bounds under the matched-pairs design
+   (ATOPnoassumption, ATOPsens and ATOPobs).  The statistics are
+   ratios of sums of a few counts over the pairs, e.g., of the treated
+   units observed, and of the outcomes of the always-observed pairs.
+   The pairs are grouped in R into classes of identical counts, so
+   that the counts of a replicate take one Poisson draw per class.
+   Given its # of draws, the pairs of a class are drawn uniformly,
+   which is needed only for the sums of the outcomes, i.e., in the
+   classes of always-observed pairs. */
+void atopBoot(int *n_pair,    /* # of pairs in each class */
+	      int *start,     /* index of the first pair of each class */
+	      double *cnt,    /* K by 7 counts of each class: treated and
+				 control units among the always-observed,
+				 treated and control units observed, treated
+				 and control units, always-observed pairs */
+	      double *y1,     /* sums of the outcomes of the treated and */
+	      double *y0,     /* control units of each always-observed
+				 pair, ordered by classes */
+	      int *n_cls,     /* # of classes: K */
+	      int *n_reps,    /* # of replicates */
+	      int *n_thread,  /* # of threads */
+	      double *reps    /* n_reps by 5: omega1, omega0, alpha1,
+				 alpha0, and pi */
+	      ) {
+  int r, K = *n_cls;
+  rngStream *rs = (rngStream *)R_alloc(*n_reps, sizeof(rngStream));
+
+  GetRNGstate();
+  for (r = 0; r < *n_reps; r++)
+    StreamSeed(rs + r);
+  PutRNGstate();
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(*n_thread > 1 ? *n_thread : 1) \
+  if (*n_thread > 1) schedule(dynamic)
+#endif
+  for (r = 0; r < *n_reps; r++) {
+    int j, k, l, m;
+    double s[7], sy1 = 0, sy0 = 0, tot = 0;
+
+    for (j = 0; j < 7; j++)
+      s[j] = 0;
+    for (k = 0; k < K; k++) {
+      m = StreamPois(rs + r, (double)n_pair[k]);
+      if (m == 0)
+	continue;
+      tot += m;
+      for (j = 0; j < 7; j++)
+	s[j] += m*cnt[k+j*K];
+      if (cnt[k] + cnt[k+K] > 0)
+	for (l = 0; l < m; l++) {
+	  j = start[k] + (int)(StreamUnif(rs + r)*n_pair[k]);
+	  sy1 += y1[j];
+	  sy0 += y0[j];
+	}
+    }
+    reps[r] = sy1/s[0];
+    reps[r+*n_reps] = sy0/s[1];
+    reps[r+2*(*n_reps)] = s[2]/s[4];
+    reps[r+3*(*n_reps)] = s[3]/s[5];
+    reps[r+4*(*n_reps)] = s[6]/tot;
+  }
+} /* end of atopBoot */
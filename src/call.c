@@ -0,0 +1,429 @@
+/****
+
+     This file contains the .Call entry points of the samplers (see
+     samplers.h).  The arguments are passed from R as one list in the
+     order of the arguments of the sampler.  The data and
+     the design matrices are read in place, the few vectors which the
+     sampler overwrites (e.g., compliance status and starting values)
+     are duplicated, and the storage for the draws is allocated here,
+     so that nothing of the size of the data is copied.
+
+****/
+
+#include <string.h>
+#include <R.h>
+#include <Rinternals.h>
+#include "samplers.h"
+
+/* maximum # of arguments of a sampler */
+#define CALL_MAX_ARGS 72
+
+
+/* Get the pointers to the arguments of a sampler from the list args.
+   kind has one character per argument:
+     'i', 'd': integer (or logical) and double vectors read in place
+     'I', 'D': integer and double vectors overwritten by the sampler,
+               which are duplicated
+     's':      character vectors, passed as char **
+     'o':      storage for the draws; the element gives its length
+   The duplicated vectors and the storage are returned as a named
+   list. */
+static SEXP CallArgs(SEXP args, const char *kind, void **a) {
+  int i, j, k, n_out = 0, n = strlen(kind);
+  char **str;
+  SEXP x, ans, names, argnames = getAttrib(args, R_NamesSymbol);
+
+  if (TYPEOF(args) != VECSXP || LENGTH(args) != n)
+    error("CallArgs: %d arguments are expected.\n", n);
+  for (i = 0; i < n; i++)
+    if (kind[i] == 'I' || kind[i] == 'D' || kind[i] == 'o')
+      n_out++;
+
+  PROTECT(ans = allocVector(VECSXP, n_out));
+  PROTECT(names = allocVector(STRSXP, n_out));
+  for (i = 0, k = 0; i < n; i++) {
+    x = VECTOR_ELT(args, i);
+    switch (kind[i]) {
+    case 'i': case 'I':
+      if (TYPEOF(x) != INTSXP && TYPEOF(x) != LGLSXP)
+	error("CallArgs: argument %d should be an integer vector.\n", i+1);
+      break;
+    case 'd': case 'D':
+      if (TYPEOF(x) != REALSXP)
+	error("CallArgs: argument %d should be a double vector.\n", i+1);
+      break;
+    case 's':
+      if (TYPEOF(x) != STRSXP)
+	error("CallArgs: argument %d should be a character vector.\n", i+1);
+      str = (char **)R_alloc(LENGTH(x), sizeof(char *));
+      for (j = 0; j < LENGTH(x); j++)
+	str[j] = (char *)translateChar(STRING_ELT(x, j));
+      a[i] = str;
+      continue;
+    case 'o':
+      x = allocVector(REALSXP, (R_xlen_t)asReal(x));
+      memset(REAL(x), 0, XLENGTH(x)*sizeof(double));
+      break;
+    default:
+      error("CallArgs: unknown kind of argument.\n");
+    }
+    if (kind[i] == 'I' || kind[i] == 'D')
+      x = duplicate(x);
+    if (kind[i] != 'i' && kind[i] != 'd') {
+      SET_VECTOR_ELT(ans, k, x);
+      if (!isNull(argnames))
+	SET_STRING_ELT(names, k, STRING_ELT(argnames, i));
+      k++;
+    }
+    a[i] = (kind[i] == 'd' || kind[i] == 'D' || kind[i] == 'o') ?
+      (void *)REAL(x) : (void *)INTEGER(x);
+  }
+  setAttrib(ans, R_NamesSymbol, names);
+
+  UNPROTECT(2);
+  return ans;
+} /* end of CallArgs */
+
+
+SEXP LIbprobitMixedCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args,
+			 "iiiIiIIiiiiiddddddDDDDiiiiiiddddddddddiddddddiiiiiooooooooo",
+			 a));
+  LIbprobitMixed(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8],
+		 a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16],
+		 a[17], a[18], a[19], a[20], a[21], a[22], a[23], a[24],
+		 a[25], a[26], a[27], a[28], a[29], a[30], a[31], a[32],
+		 a[33], a[34], a[35], a[36], a[37], a[38], a[39], a[40],
+		 a[41], a[42], a[43], a[44], a[45], a[46], a[47], a[48],
+		 a[49], a[50], a[51], a[52], a[53], a[54], a[55], a[56],
+		 a[57], a[58]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP LINormalMixedCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args,
+			 "diiIiIIiiiiiddddddDDDDDiiiiiiddddddddddididdddddiiiiioooooooooo",
+			 a));
+  LINormalMixed(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8],
+		a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16],
+		a[17], a[18], a[19], a[20], a[21], a[22], a[23], a[24],
+		a[25], a[26], a[27], a[28], a[29], a[30], a[31], a[32],
+		a[33], a[34], a[35], a[36], a[37], a[38], a[39], a[40],
+		a[41], a[42], a[43], a[44], a[45], a[46], a[47], a[48],
+		a[49], a[50], a[51], a[52], a[53], a[54], a[55], a[56],
+		a[57], a[58], a[59], a[60], a[61], a[62]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP LIboprobitMixedCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args,
+			 "iiiIiIIiiiiiddddddDDDDDiiiiiiiddddddddddidddddddiiiiiioooooooooo",
+			 a));
+  LIboprobitMixed(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8],
+		  a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16],
+		  a[17], a[18], a[19], a[20], a[21], a[22], a[23],
+		  a[24], a[25], a[26], a[27], a[28], a[29], a[30],
+		  a[31], a[32], a[33], a[34], a[35], a[36], a[37],
+		  a[38], a[39], a[40], a[41], a[42], a[43], a[44],
+		  a[45], a[46], a[47], a[48], a[49], a[50], a[51],
+		  a[52], a[53], a[54], a[55], a[56], a[57], a[58],
+		  a[59], a[60], a[61], a[62], a[63]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP LINegBinMixedCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args,
+			 "iiiIiIIiiiiiddddddDDDDDiiiiiddddddddddddidddddddddiiiiioooooooooo",
+			 a));
+  LINegBinMixed(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8],
+		a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16],
+		a[17], a[18], a[19], a[20], a[21], a[22], a[23], a[24],
+		a[25], a[26], a[27], a[28], a[29], a[30], a[31], a[32],
+		a[33], a[34], a[35], a[36], a[37], a[38], a[39], a[40],
+		a[41], a[42], a[43], a[44], a[45], a[46], a[47], a[48],
+		a[49], a[50], a[51], a[52], a[53], a[54], a[55], a[56],
+		a[57], a[58], a[59], a[60], a[61], a[62], a[63], a[64]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP LItwopartMixedCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args,
+			 "idiiIiIIiiiiddddddDDDDDiiiiiiddddddddddididdddddiiiiioooooooooooo",
+			 a));
+  LItwopartMixed(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8],
+		 a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16],
+		 a[17], a[18], a[19], a[20], a[21], a[22], a[23], a[24],
+		 a[25], a[26], a[27], a[28], a[29], a[30], a[31], a[32],
+		 a[33], a[34], a[35], a[36], a[37], a[38], a[39], a[40],
+		 a[41], a[42], a[43], a[44], a[45], a[46], a[47], a[48],
+		 a[49], a[50], a[51], a[52], a[53], a[54], a[55], a[56],
+		 a[57], a[58], a[59], a[60], a[61], a[62], a[63],
+		 a[64]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP NIbprobitMixedCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args,
+			 "IiiiiddddDDddiiiiiiddddiiddiiiiiiioooooo",
+			 a));
+  NIbprobitMixed(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8],
+		 a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16],
+		 a[17], a[18], a[19], a[20], a[21], a[22], a[23], a[24],
+		 a[25], a[26], a[27], a[28], a[29], a[30], a[31], a[32],
+		 a[33], a[34], a[35], a[36], a[37], a[38], a[39]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP LIbinaryCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args,
+			 "iiiIiIIiiidddDDDDiiiiidddddddddiiiiiiiisisiiiiiiddiiiidiidiidoooooooo",
+			 a));
+  LIbinary(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9],
+	   a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17],
+	   a[18], a[19], a[20], a[21], a[22], a[23], a[24], a[25],
+	   a[26], a[27], a[28], a[29], a[30], a[31], a[32], a[33],
+	   a[34], a[35], a[36], a[37], a[38], a[39], a[40], a[41],
+	   a[42], a[43], a[44], a[45], a[46], a[47], a[48], a[49],
+	   a[50], a[51], a[52], a[53], a[54], a[55], a[56], a[57],
+	   a[58], a[59], a[60], a[61], a[62], a[63], a[64], a[65],
+	   a[66], a[67], a[68]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP LIordinalCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args,
+			 "iiiIiIIiiidddDDDDDiiiiiidddddddddiiiiiiissiiiiooooooo",
+			 a));
+  LIordinal(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9],
+	    a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17],
+	    a[18], a[19], a[20], a[21], a[22], a[23], a[24], a[25],
+	    a[26], a[27], a[28], a[29], a[30], a[31], a[32], a[33],
+	    a[34], a[35], a[36], a[37], a[38], a[39], a[40], a[41],
+	    a[42], a[43], a[44], a[45], a[46], a[47], a[48], a[49],
+	    a[50], a[51], a[52]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP LIgaussianCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args,
+			 "diiIiIIiiidddDDDDDiiiiiddddddidddiiiiiiissiiiiiddiiiidiidiidoooooooo",
+			 a));
+  LIgaussian(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9],
+	     a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17],
+	     a[18], a[19], a[20], a[21], a[22], a[23], a[24], a[25],
+	     a[26], a[27], a[28], a[29], a[30], a[31], a[32], a[33],
+	     a[34], a[35], a[36], a[37], a[38], a[39], a[40], a[41],
+	     a[42], a[43], a[44], a[45], a[46], a[47], a[48], a[49],
+	     a[50], a[51], a[52], a[53], a[54], a[55], a[56], a[57],
+	     a[58], a[59], a[60], a[61], a[62], a[63], a[64], a[65],
+	     a[66], a[67]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP LIcountCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args,
+			 "iiiIiIIiiidddDDDDDiiiiiddddddddddddiiiiiiissiiiiiooooooo",
+			 a));
+  LIcount(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9],
+	  a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17], a[18],
+	  a[19], a[20], a[21], a[22], a[23], a[24], a[25], a[26], a[27],
+	  a[28], a[29], a[30], a[31], a[32], a[33], a[34], a[35], a[36],
+	  a[37], a[38], a[39], a[40], a[41], a[42], a[43], a[44], a[45],
+	  a[46], a[47], a[48], a[49], a[50], a[51], a[52], a[53], a[54],
+	  a[55]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP LItwopartCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args,
+			 "idiiIiIIiiidddDDDDDDiiiiiddddddidddiiiiiiissiiiiioooooooo",
+			 a));
+  LItwopart(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9],
+	    a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17],
+	    a[18], a[19], a[20], a[21], a[22], a[23], a[24], a[25],
+	    a[26], a[27], a[28], a[29], a[30], a[31], a[32], a[33],
+	    a[34], a[35], a[36], a[37], a[38], a[39], a[40], a[41],
+	    a[42], a[43], a[44], a[45], a[46], a[47], a[48], a[49],
+	    a[50], a[51], a[52], a[53], a[54], a[55], a[56]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP MARprobitCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args,
+			 "IiiiiIdDddiiiiiidddddiiiiiiiiiddoooo",
+			 a));
+  MARprobit(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9],
+	    a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17],
+	    a[18], a[19], a[20], a[21], a[22], a[23], a[24], a[25],
+	    a[26], a[27], a[28], a[29], a[30], a[31], a[32], a[33],
+	    a[34], a[35]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP NIbprobitCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args,
+			 "IidDDDiiiiddddiiiiiiiiiiiidiidiiddooooooo",
+			 a));
+  NIbprobit(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9],
+	    a[10], a[11], a[12], a[13], a[14], a[15], a[16], a[17],
+	    a[18], a[19], a[20], a[21], a[22], a[23], a[24], a[25],
+	    a[26], a[27], a[28], a[29], a[30], a[31], a[32], a[33],
+	    a[34], a[35], a[36], a[37], a[38], a[39], a[40]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP boundsBootCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args, "iiidddiiidiiiio", a));
+  boundsBoot(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9],
+	     a[10], a[11], a[12], a[13], a[14]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP boundsSupCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args, "ddio", a));
+  boundsSup(a[0], a[1], a[2], a[3]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP boundsAggCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args, "iiddddiiiDio", a));
+  boundsAgg(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9],
+	    a[10], a[11]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP atopBootCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args, "iidddiiio", a));
+  atopBoot(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP aupecStatCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args, "didiiio", a));
+  aupecStat(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP papeStatCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args, "idiiiiidio", a));
+  papeStat(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP clusterMomentsCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args, "iidddiiooo", a));
+  clusterMoments(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8],
+		 a[9]);
+  UNPROTECT(1);
+  return ans;
+}
+
+
+SEXP cadeRegMeatCall(SEXP args) {
+  void *a[CALL_MAX_ARGS];
+  SEXP ans;
+
+  PROTECT(ans = CallArgs(args, "iiddddiiiooooo", a));
+  cadeRegMeat(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9],
+	      a[10], a[11], a[12], a[13]);
+  UNPROTECT(1);
+  return ans;
+}
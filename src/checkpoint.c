@@ -0,0 +1,210 @@
+/****
+
+     This file contains the checkpoint of a sampler.  A sampler
+     registers the memory which carries its state from one iteration
+     to the next (parameters, latent variables, counters), and
+     CkptSave() writes it together with the state of R's random
+     number generator (.Random.seed) so that CkptLoad() can continue
+     the chain exactly where it stopped.  The file is first written
+     under a temporary name and then renamed, so that an interrupted
+     save leaves the previous checkpoint intact.
+
+     File layout (native byte order):
+       char[8]   "EXPCKPT"
+       int       version, # of blocks
+       per block: char[16] name, int type, int length, data
+       int       length of .Random.seed, .Random.seed
+
+****/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <R.h>
+#include <Rinternals.h>
+#include "checkpoint.h"
+
+#define CKPT_MAGIC "EXPCKPT"
+#define CKPT_VERSION 1
+
+
+ckptState *CkptOpen(const char *file) {
+  ckptState *ck = (ckptState *)malloc(sizeof(ckptState));
+
+  if (!ck)
+    error("Out of memory error in CkptOpen\n");
+  ck->file = (char *)malloc(strlen(file)+1);
+  ck->tmp = (char *)malloc(strlen(file)+5);
+  if (!ck->file || !ck->tmp)
+    error("Out of memory error in CkptOpen\n");
+  strcpy(ck->file, file);
+  strcpy(ck->tmp, file);
+  strcat(ck->tmp, ".tmp");
+  ck->n_block = 0;
+  return ck;
+} /* end of CkptOpen */
+
+
+static void CkptAdd(ckptState *ck, const char *name, int type, void *x,
+		    int len) {
+  int k = ck->n_block;
+
+  if (k == CKPT_MAX_BLOCK)
+    error("CkptAdd: too many blocks.\n");
+  memset(ck->name[k], 0, CKPT_NAME_LEN);
+  strncpy(ck->name[k], name, CKPT_NAME_LEN-1);
+  ck->type[k] = type;
+  ck->len[k] = len;
+  ck->data[k] = x;
+  ck->n_block++;
+}
+
+/* Register a block of the state */
+void CkptInt(ckptState *ck, const char *name, int *x, int len) {
+  CkptAdd(ck, name, CKPT_INT, x, len);
+}
+
+void CkptDouble(ckptState *ck, const char *name, double *x, int len) {
+  CkptAdd(ck, name, CKPT_DOUBLE, x, len);
+}
+
+/* Register a block which must be the same when the chain is resumed,
+   e.g., dimensions and the # of draws; the values are copied */
+void CkptConst(ckptState *ck, const char *name, int *x, int len) {
+  int *copy = (int *)malloc((len > 0 ? len : 1)*sizeof(int));
+
+  if (!copy)
+    error("Out of memory error in CkptConst\n");
+  memcpy(copy, x, len*sizeof(int));
+  CkptAdd(ck, name, CKPT_CONST, copy, len);
+}
+
+
+/* fwrite and fread with error check */
+static void CkptWrite(FILE *fp, const void *ptr, size_t size, size_t n) {
+  if (fwrite(ptr, size, n, fp) != n) {
+    fclose(fp);
+    error("CkptWrite: writing the checkpoint failed.\n");
+  }
+}
+
+static void CkptRead(FILE *fp, void *ptr, size_t size, size_t n,
+		     const char *file) {
+  if (fread(ptr, size, n, fp) != n) {
+    fclose(fp);
+    error("CkptRead: %s is not a complete checkpoint.\n", file);
+  }
+}
+
+static size_t CkptSize(int type) {
+  return (type == CKPT_DOUBLE) ? sizeof(double) : sizeof(int);
+}
+
+
+/* Write the registered blocks and the random seed */
+void CkptSave(ckptState *ck) {
+  int k, n;
+  int header[2];
+  FILE *fp;
+  SEXP seed;
+
+  /* the generator keeps running; .Random.seed is only a copy */
+  PutRNGstate();
+  seed = findVar(install(".Random.seed"), R_GlobalEnv);
+  if (seed == R_UnboundValue || TYPEOF(seed) != INTSXP)
+    error("CkptSave: .Random.seed is not available.\n");
+
+  fp = fopen(ck->tmp, "wb");
+  if (!fp)
+    error("CkptSave: cannot open %s for writing.\n", ck->tmp);
+  header[0] = CKPT_VERSION;
+  header[1] = ck->n_block;
+  CkptWrite(fp, CKPT_MAGIC, 1, 8);
+  CkptWrite(fp, header, sizeof(int), 2);
+  for (k = 0; k < ck->n_block; k++) {
+    CkptWrite(fp, ck->name[k], 1, CKPT_NAME_LEN);
+    CkptWrite(fp, &(ck->type[k]), sizeof(int), 1);
+    CkptWrite(fp, &(ck->len[k]), sizeof(int), 1);
+    CkptWrite(fp, ck->data[k], CkptSize(ck->type[k]), ck->len[k]);
+  }
+  n = LENGTH(seed);
+  CkptWrite(fp, &n, sizeof(int), 1);
+  CkptWrite(fp, INTEGER(seed), sizeof(int), n);
+  if (fclose(fp) != 0)
+    error("CkptSave: writing the checkpoint failed.\n");
+
+  /* replace the previous checkpoint; rename() does not overwrite on
+     all platforms */
+  remove(ck->file);
+  if (rename(ck->tmp, ck->file) != 0)
+    error("CkptSave: cannot rename %s to %s.\n", ck->tmp, ck->file);
+} /* end of CkptSave */
+
+
+/* Restore the registered blocks and the random seed */
+void CkptLoad(ckptState *ck) {
+  int i, k, n, type, len;
+  int header[2];
+  char magic[8], name[CKPT_NAME_LEN];
+  int *itemp;
+  FILE *fp;
+  SEXP seed;
+
+  fp = fopen(ck->file, "rb");
+  if (!fp)
+    error("CkptLoad: cannot open %s.\n", ck->file);
+  CkptRead(fp, magic, 1, 8, ck->file);
+  CkptRead(fp, header, sizeof(int), 2, ck->file);
+  if (memcmp(magic, CKPT_MAGIC, 8) != 0 || header[0] != CKPT_VERSION ||
+      header[1] != ck->n_block) {
+    fclose(fp);
+    error("CkptLoad: %s is not a checkpoint of this sampler.\n", ck->file);
+  }
+  for (k = 0; k < ck->n_block; k++) {
+    CkptRead(fp, name, 1, CKPT_NAME_LEN, ck->file);
+    CkptRead(fp, &type, sizeof(int), 1, ck->file);
+    CkptRead(fp, &len, sizeof(int), 1, ck->file);
+    if (memcmp(name, ck->name[k], CKPT_NAME_LEN) != 0 ||
+	type != ck->type[k] || len != ck->len[k]) {
+      fclose(fp);
+      error("CkptLoad: %s is not a checkpoint of this sampler.\n",
+	    ck->file);
+    }
+    if (type == CKPT_CONST) {
+      itemp = (int *)malloc((len > 0 ? len : 1)*sizeof(int));
+      if (!itemp)
+	error("Out of memory error in CkptLoad\n");
+      CkptRead(fp, itemp, sizeof(int), len, ck->file);
+      for (i = 0; i < len; i++)
+	if (itemp[i] != ((int *)ck->data[k])[i]) {
+	  free(itemp);
+	  fclose(fp);
+	  error("CkptLoad: %s does not match the data and the settings (%s).\n",
+		ck->file, ck->name[k]);
+	}
+      free(itemp);
+    }
+    else
+      CkptRead(fp, ck->data[k], CkptSize(type), len, ck->file);
+  }
+
+  CkptRead(fp, &n, sizeof(int), 1, ck->file);
+  PROTECT(seed = allocVector(INTSXP, n));
+  CkptRead(fp, INTEGER(seed), sizeof(int), n, ck->file);
+  fclose(fp);
+  defineVar(install(".Random.seed"), seed, R_GlobalEnv);
+  UNPROTECT(1);
+  GetRNGstate();
+} /* end of CkptLoad */
+
+
+void CkptClose(ckptState *ck) {
+  int k;
+
+  for (k = 0; k < ck->n_block; k++)
+    if (ck->type[k] == CKPT_CONST)
+      free(ck->data[k]);
+  free(ck->file);
+  free(ck->tmp);
+  free(ck);
+} /* end of CkptClose */
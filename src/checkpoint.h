@@ -0,0 +1,28 @@
+/* maximum number of blocks in a checkpoint and length of a block name */
+#define CKPT_MAX_BLOCK 32
+#define CKPT_NAME_LEN 16
+
+/* types of blocks; a constant block is checked rather than restored */
+#define CKPT_INT 0
+#define CKPT_DOUBLE 1
+#define CKPT_CONST 2
+
+/* checkpoint of the state of a sampler: the registered blocks of
+   memory and the state of the random number generator */
+typedef struct {
+  char *file;
+  char *tmp;                        /* file written before renaming */
+  int n_block;
+  char name[CKPT_MAX_BLOCK][CKPT_NAME_LEN];
+  int type[CKPT_MAX_BLOCK];
+  int len[CKPT_MAX_BLOCK];          /* length of each block */
+  void *data[CKPT_MAX_BLOCK];
+} ckptState;
+
+ckptState *CkptOpen(const char *file);
+void CkptInt(ckptState *ck, const char *name, int *x, int len);
+void CkptDouble(ckptState *ck, const char *name, double *x, int len);
+void CkptConst(ckptState *ck, const char *name, int *x, int len);
+void CkptSave(ckptState *ck);
+void CkptLoad(ckptState *ck);
+void CkptClose(ckptState *ck);
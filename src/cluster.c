@@ -0,0 +1,181 @@
+/****
+
+     This file contains the moments of the two-stage randomized
+     experiments, whose units are grouped in clusters: CADErand.  The
+     estimates depend on the data only through the means, variances
+     and covariances of the treatment received and the outcome within
+     each cluster and treatment assignment, which are accumulated by
+     one pass over the units in the order of the data.  They use the
+     updates of Welford, so that the variances are not differences of
+     large sums of squares.
+
+     The sandwich variances of the regression estimators (CADEreg)
+     sum p by p outer products over the units or the clusters, which
+     takes one pass over each cluster of the rows sorted by cluster
+     and O(p^2) memory, instead of the N by N diag(W).
+
+****/
+
+#include <stdlib.h>
+#include <R.h>
+#include <Rmath.h>
+#include "vector.h"
+#include "samplers.h"
+
+
+void clusterMoments(int *id,       /* cluster of each unit: 0, ..., J-1 */
+		    int *Z,        /* treatment assignment: 0 or 1 */
+		    double *D,     /* treatment received */
+		    double *Y,     /* outcome */
+		    double *A,     /* assignment mechanism */
+		    int *n_samp,   /* # of units */
+		    int *n_cluster,/* # of clusters: J */
+		    double *mom,   /* J by 12 moments: for Z = 0 then 1, #
+				      of units, means of D and Y, sums of
+				      squares of D and Y about them, and
+				      their sum of cross-products */
+		    double *Aj,    /* assignment mechanism of each cluster */
+		    double *bad    /* first cluster (1, ...) whose units do
+				      not share A; 0 if none */
+		    ) {
+  int i, j, k, J = *n_cluster;
+  double n, dd, dy;
+  double *m;
+  int *seen = intArray(J);
+
+  for (k = 0; k < 12*J; k++)
+    mom[k] = 0;
+  for (j = 0; j < J; j++)
+    seen[j] = 0;
+  *bad = 0;
+  for (i = 0; i < *n_samp; i++) {
+    j = id[i];
+    m = mom + j + 6*Z[i]*J;
+    if (!seen[j]) {
+      Aj[j] = A[i];
+      seen[j] = 1;
+    } else if (Aj[j] != A[i] && (*bad == 0 || j+1 < *bad))
+      *bad = j+1;
+    n = ++m[0];
+    dd = D[i] - m[J];
+    dy = Y[i] - m[2*J];
+    m[J] += dd/n;
+    m[2*J] += dy/n;
+    m[3*J] += dd*(D[i] - m[J]);
+    m[4*J] += dy*(Y[i] - m[2*J]);
+    m[5*J] += dd*(Y[i] - m[2*J]);
+  }
+  /* the means of an empty group are undefined */
+  for (k = 0; k < 2; k++)
+    for (j = 0; j < J; j++) {
+      m = mom + j + 6*k*J;
+      if (m[0] == 0) {
+	m[J] = R_NaN;
+	m[2*J] = R_NaN;
+      }
+    }
+
+  free(seen);
+} /* end of clusterMoments */
+
+
+/* The bread and meats of the sandwich variances of CADEreg.  The
+   rows are sorted by cluster; M is the N by p design of the second
+   stage, W the weights and res the residuals.  The score of cluster
+   j is s_j = sum of W_i M_i res_i over its units, and those of the
+   units of cluster j with Z = z are adjusted by the mean of their
+   residuals for the individual-robust meat. */
+void cadeRegMeat(int *id,        /* cluster of each row: 0, ..., J-1 */
+		 int *Z,         /* treatment assignment: 0 or 1 */
+		 double *A,      /* assignment mechanism of each cluster */
+		 double *W,      /* weight */
+		 double *M,      /* N by p design */
+		 double *res,    /* residual */
+		 int *n_samp,    /* # of rows: N */
+		 int *n_cluster, /* # of clusters: J */
+		 int *n_cov,     /* p */
+		 double *MM,     /* p by p: sum of W M M' */
+		 double *clu,    /* cluster-robust meat: sum of s s' */
+		 double *clu_hc2,/* with the HC2 factors of the clusters */
+		 double *ind,    /* individual-robust HC2 meat */
+		 double *hc2     /* HC2 meat */
+		 ) {
+  int i, j, a, b, lo, hi, N = *n_samp, p = *n_cov;
+  double J1 = 0, J0, n1, n0, r1, r0, w, e, r, ki, ci, cj;
+  double *s, *m;
+
+  /* checked before anything is allocated */
+  for (i = 0; i < N; i++)
+    if (id[i] < 0 || id[i] >= *n_cluster || (i > 0 && id[i] < id[i-1]))
+      error("cadeRegMeat: the rows should be sorted by cluster.\n");
+  s = doubleArray(p);
+  m = doubleArray(p);
+
+  for (j = 0; j < *n_cluster; j++)
+    if (A[j] == 1)
+      J1++;
+  J0 = *n_cluster - J1;
+  for (a = 0; a < p*p; a++) {
+    MM[a] = 0; clu[a] = 0; clu_hc2[a] = 0; ind[a] = 0; hc2[a] = 0;
+  }
+
+  for (lo = 0; lo < N; lo = hi) {
+    j = id[lo];
+    n1 = 0; n0 = 0; r1 = 0; r0 = 0;
+    for (hi = lo; hi < N && id[hi] == j; hi++)
+      if (Z[hi]) {
+	n1++;
+	r1 += res[hi];
+      } else {
+	n0++;
+	r0 += res[hi];
+      }
+    r1 /= n1;
+    r0 /= n0;
+
+    for (a = 0; a < p; a++)
+      s[a] = 0;
+    for (i = lo; i < hi; i++) {
+      w = W[i];
+      e = res[i];
+      if (Z[i]) {
+	r = e - r1;
+	ki = n1/(n1-1);
+	ci = A[j] == 1 ? J1*n1/(J1*n1-1) : J0*n1/(J1*n1-1);
+      } else {
+	r = e - r0;
+	ki = n0/(n0-1);
+	ci = A[j] == 1 ? J1*n0/(J1*n0-1) : J0*n0/(J1*n0-1);
+      }
+      for (a = 0; a < p; a++) {
+	m[a] = M[i+(size_t)a*N];
+	s[a] += w*m[a]*e;
+      }
+      for (a = 0; a < p; a++)
+	for (b = a; b < p; b++) {
+	  MM[a+b*p] += w*m[a]*m[b];
+	  ind[a+b*p] += w*w*ki*r*r*m[a]*m[b];
+	  hc2[a+b*p] += w*w*ci*e*e*m[a]*m[b];
+	}
+    }
+    cj = A[j] == 1 ? J1/(J1-1) : J0/(J0-1);
+    for (a = 0; a < p; a++)
+      for (b = a; b < p; b++) {
+	clu[a+b*p] += s[a]*s[b];
+	clu_hc2[a+b*p] += cj*s[a]*s[b];
+      }
+  }
+
+  /* the lower triangles */
+  for (a = 0; a < p; a++)
+    for (b = 0; b < a; b++) {
+      MM[a+b*p] = MM[b+a*p];
+      clu[a+b*p] = clu[b+a*p];
+      clu_hc2[a+b*p] = clu_hc2[b+a*p];
+      ind[a+b*p] = ind[b+a*p];
+      hc2[a+b*p] = hc2[b+a*p];
+    }
+
+  free(s);
+  free(m);
+} /* end of cadeRegMeat */
@@ -0,0 +1,568 @@
+/****
+
+     This file contains the kernels for design matrices which are
+     kept in R's column-major layout.  Linear predictors are computed
+     column by column with BLAS dgemv and the cross-product X'X with
+     dsyrk on the same memory, so that the data are neither transposed
+     nor copied before the first draw.  X'X is computed once and only
+     the columns which a sampler overwrites are updated.  The prior is
+     added to the cross-products directly rather than as additional
+     data points.
+
+     For large designs of dummies and standardized scores, X can be
+     stored in single precision instead, which halves the memory read
+     by each pass over the data.  The float copy is then read by plain
+     loops which accumulate the linear predictors and cross-products
+     in double, so only the covariates are rounded.  R keeps its
+     double matrix, so the copy cuts the bytes read per draw, not the
+     memory in use.
+
+     The trailing columns of a design, e.g., hundreds of one-hot site
+     dummies, may be passed as compressed sparse columns (the p, i,
+     and x slots of a dgCMatrix).  Their linear predictors and
+     cross-products then cost in proportion to the # of nonzeros
+     rather than to n_samp.  The leading columns, which the samplers
+     overwrite (e.g., imputed outcomes or compliance status), are
+     always dense.  They may be kept in a small buffer T of their own,
+     so that R's matrix of the other covariates is read in place and
+     never written.
+
+     When units with identical covariates are collapsed into one row,
+     the row is weighted by the # of units it stands for.  X'X is then
+     X'WX, and the weight of a row can be changed at the cost of a
+     rank-one update, e.g., when the units of a pattern move between
+     the rows of its imputed outcomes.
+
+     A regression on a subset of the rows, e.g., the units with
+     observed outcomes or the noncompliers, gets a view of the whole
+     design whose rows are weighted by 0 or 1 (DesignView), so that
+     the rows are not copied; the weights of a view may change between
+     the draws.
+
+****/
+
+#define USE_FC_LEN_T
+#include <stdlib.h>
+#include <R.h>
+#include <R_ext/BLAS.h>
+#include "vector.h"
+#include "design.h"
+
+
+/* inner product of a float column and a double vector */
+static double DesignDot(float *x, double *y, int n) {
+  int i;
+  double sum = 0;
+
+  for (i = 0; i < n; i++)
+    sum += x[i]*y[i];
+  return sum;
+}
+
+
+/* inner product of two float columns */
+static double DesignDotf(float *x, float *y, int n) {
+  int i;
+  double sum = 0;
+
+  for (i = 0; i < n; i++)
+    sum += (double)x[i]*y[i];
+  return sum;
+}
+
+
+/* inner product of two double columns */
+static double DesignDotd(double *x, double *y, int n) {
+  int i;
+  double sum = 0;
+
+  for (i = 0; i < n; i++)
+    sum += x[i]*y[i];
+  return sum;
+}
+
+
+/* dense column j in double precision: in T or X */
+static double *DesignCol(colDesign *d, int j) {
+  if (j < d->n_lead)
+    return d->T + (size_t)j*d->n_samp;
+  return d->X + (size_t)(j-d->n_lead)*d->n_samp;
+}
+
+
+/* element (i, j) of the dense columns */
+static double DesignElt(colDesign *d, int i, int j) {
+  if (d->Xf)
+    return d->Xf[i+(size_t)j*d->n_samp];
+  return DesignCol(d, j)[i];
+}
+
+
+/* Xy = X'y for the first n_col dense columns; the columns of T are
+   read one by one and those of X by dgemv */
+static void DesignDenseXty(colDesign *d, int n_col, double *y,
+			   double *Xy) {
+  int j, n_rest = n_col - d->n_lead;
+  double one = 1, zero = 0;
+  int ione = 1;
+
+  if (d->Xf) {
+    for (j = 0; j < n_col; j++)
+      Xy[j] = DesignDot(d->Xf + (size_t)j*d->n_samp, y, d->n_samp);
+    return;
+  }
+  for (j = 0; j < n_col && j < d->n_lead; j++)
+    Xy[j] = DesignDotd(d->T + (size_t)j*d->n_samp, y, d->n_samp);
+  if (n_rest > 0)
+    F77_CALL(dgemv)("T", &(d->n_samp), &n_rest, &one, d->X, &(d->n_samp),
+		    y, &ione, &zero, Xy + d->n_lead, &ione FCONE);
+}
+
+
+/* weight of row i; v is NULL if one each */
+static double DesignW(double *v, int i) {
+  return v ? v[i] : 1;
+}
+
+
+/* weighted inner product of sparse column k and dense column j */
+static double DesignSparseDot(colDesign *d, double *v, int k, int j) {
+  int l;
+  double sum = 0;
+
+  for (l = d->sp_p[k]; l < d->sp_p[k+1]; l++)
+    sum += DesignW(v, d->sp_i[l])*d->sp_x[l]*DesignElt(d, d->sp_i[l], j);
+  return sum;
+}
+
+
+/* cross-products among the sparse columns, accumulated row by row so
+   that the cost is the sum of the squared # of nonzeros in each row */
+static void DesignSparseXX(colDesign *d, double *v, double *XX) {
+  int i, k, l, a, b, ca, n_sparse = d->n_cov - d->n_dense;
+  int nnz = d->sp_p[n_sparse];
+  int *row_p = intArray(d->n_samp+1);
+  int *row_c = intArray(nnz > 0 ? nnz : 1);
+  double *row_x = doubleArray(nnz > 0 ? nnz : 1);
+
+  /* the sparse columns stored by rows, columns in increasing order */
+  for (i = 0; i <= d->n_samp; i++)
+    row_p[i] = 0;
+  for (l = 0; l < nnz; l++)
+    row_p[d->sp_i[l]+1]++;
+  for (i = 0; i < d->n_samp; i++)
+    row_p[i+1] += row_p[i];
+  for (k = 0; k < n_sparse; k++)
+    for (l = d->sp_p[k]; l < d->sp_p[k+1]; l++) {
+      i = d->sp_i[l];
+      row_c[row_p[i]] = d->n_dense + k;
+      row_x[row_p[i]++] = d->sp_x[l];
+    }
+  for (i = d->n_samp; i > 0; i--)
+    row_p[i] = row_p[i-1];
+  row_p[0] = 0;
+
+  for (i = 0; i < d->n_samp; i++)
+    for (a = row_p[i]; a < row_p[i+1]; a++) {
+      ca = row_c[a];
+      for (b = a; b < row_p[i+1]; b++)
+	XX[ca+(size_t)row_c[b]*d->n_cov] += DesignW(v, i)*row_x[a]*row_x[b];
+    }
+
+  free(row_p);
+  free(row_c);
+  free(row_x);
+} /* end of DesignSparseXX */
+
+
+/* The cross-products X'VX, V = diag(v), of all the columns; v is NULL
+   if each row counts once */
+void DesignCross(colDesign *d, double *v, double *XX) {
+  int i, j, k, n_samp = d->n_samp, n_cov = d->n_cov, n_dense = d->n_dense;
+  int n_lead = d->n_lead, n_rest = n_dense - n_lead;
+  double one = 1, zero = 0;
+  double *x, *Xy;
+
+  for (j = 0; j < n_cov*n_cov; j++)
+    XX[j] = 0;
+
+  /* dense columns */
+  if (v) { /* column k of X'V X is X'(v * x_k) */
+    x = doubleArray(n_samp);
+    Xy = doubleArray(n_dense > 0 ? n_dense : 1);
+    for (k = 0; k < n_dense; k++) {
+      for (i = 0; i < n_samp; i++)
+	x[i] = v[i]*DesignElt(d, i, k);
+      DesignDenseXty(d, k+1, x, Xy);
+      for (j = 0; j <= k; j++)
+	XX[j+k*n_cov] = Xy[j];
+    }
+    free(x);
+    free(Xy);
+  } else if (d->Xf)
+    for (k = 0; k < n_dense; k++)
+      for (j = 0; j <= k; j++)
+	XX[j+k*n_cov] = DesignDotf(d->Xf + (size_t)j*n_samp,
+				   d->Xf + (size_t)k*n_samp, n_samp);
+  else {
+    if (n_rest > 0)
+      F77_CALL(dsyrk)("U", "T", &n_rest, &n_samp, &one, d->X, &n_samp,
+		      &zero, XX + n_lead + n_lead*n_cov, &n_cov FCONE FCONE);
+    Xy = doubleArray(n_dense > 0 ? n_dense : 1);
+    for (j = 0; j < n_lead; j++) {
+      DesignDenseXty(d, n_dense, DesignCol(d, j), Xy);
+      for (k = j; k < n_dense; k++)
+	XX[j+k*n_cov] = Xy[k];
+    }
+    free(Xy);
+  }
+
+  /* sparse columns */
+  if (n_dense < n_cov) {
+    for (k = n_dense; k < n_cov; k++)
+      for (j = 0; j < n_dense; j++)
+	XX[j+k*n_cov] = DesignSparseDot(d, v, k-n_dense, j);
+    DesignSparseXX(d, v, XX);
+  }
+
+  for (k = 0; k < n_cov; k++)
+    for (j = k+1; j < n_cov; j++)
+      XX[j+k*n_cov] = XX[k+j*n_cov];
+} /* end of DesignCross */
+
+
+/* A0 %*% beta0 and beta0' A0 beta0 of the prior A0, beta0 (zero if A0
+   is NULL) */
+static void DesignPrior(colDesign *d, double *A0, double *beta0) {
+  int j, k, n_cov = d->n_cov;
+
+  d->A0 = A0;
+  d->b0A0b0 = 0;
+  for (j = 0; j < n_cov; j++)
+    d->A0b0[j] = 0;
+  if (!A0)
+    return;
+  for (j = 0; j < n_cov; j++) {
+    for (k = 0; k < n_cov; k++)
+      d->A0b0[j] += A0[j+k*n_cov]*beta0[k];
+    d->b0A0b0 += beta0[j]*d->A0b0[j];
+  }
+}
+
+
+/* Wrap the design and compute X'X.  The first n_dense columns are
+   dense: the first n_lead of them in T (NULL if n_lead == 0), which
+   the sampler may overwrite, and the others in the column-major X,
+   which is n_samp by n_dense - n_lead and only read.  The other
+   columns are in compressed sparse columns (sp_p, sp_i, sp_x; NULL if
+   n_dense == n_cov).  w holds the # of units in each row (NULL if one
+   each); it is updated by DesignRowWeight().  A0 and beta0 are the
+   prior precision (column-major) and mean.  A design which is only
+   used for linear predictors, e.g., by a logistic regression, has A0
+   = NULL, and its X'X is not computed.  With single = 1, the dense
+   columns are copied to float and the copy is used from now on. */
+colDesign *DesignOpen(double *X, int n_samp, int n_cov, int n_dense,
+		      double *T, int n_lead, int *sp_p, int *sp_i,
+		      double *sp_x, double *w, double *A0, double *beta0,
+		      int single) {
+  int i, j;
+  size_t n = (size_t)n_samp*n_dense;
+  double *x;
+  colDesign *d = (colDesign *)malloc(sizeof(colDesign));
+
+  if (!d)
+    error("Out of memory error in DesignOpen\n");
+  if (n_lead > n_dense)
+    error("DesignOpen: the columns in T should be dense.\n");
+  d->X = X;
+  d->T = T;
+  d->n_lead = n_lead;
+  d->n_samp = n_samp;
+  d->n_cov = n_cov;
+  d->n_dense = n_dense;
+  d->sp_p = sp_p;
+  d->sp_i = sp_i;
+  d->sp_x = sp_x;
+  d->w = w;
+  d->XX = doubleArray(n_cov*n_cov);
+  d->A0b0 = doubleArray(n_cov);
+  d->Xy = doubleArray(n_cov);
+  d->Xf = NULL;
+  d->view = 0;
+
+  if (single) {
+    d->Xf = (float *)malloc((n > 0 ? n : 1)*sizeof(float));
+    if (!d->Xf)
+      error("Out of memory error in DesignOpen\n");
+    for (j = 0; j < n_dense; j++) {
+      x = DesignCol(d, j);
+      for (i = 0; i < n_samp; i++)
+	d->Xf[i+(size_t)j*n_samp] = (float)x[i];
+    }
+  }
+  DesignPrior(d, A0, beta0);
+  if (A0)
+    DesignCross(d, w, d->XX);
+  return d;
+} /* end of DesignOpen */
+
+
+/* The columns of d with a copy of the row weights w, e.g., 0 or 1 for
+   a regression on a subset of the rows, which may change between the
+   draws (see DesignWeights), and the prior A0, beta0 as in
+   DesignOpen; the data are shared with d, which must stay open */
+colDesign *DesignView(colDesign *d, double *w, double *A0,
+		      double *beta0) {
+  int i;
+  colDesign *v = (colDesign *)malloc(sizeof(colDesign));
+
+  if (!v)
+    error("Out of memory error in DesignView\n");
+  *v = *d;
+  v->view = 1;
+  v->w = doubleArray(d->n_samp);
+  v->XX = doubleArray(d->n_cov*d->n_cov);
+  v->A0b0 = doubleArray(d->n_cov);
+  v->Xy = doubleArray(d->n_cov);
+  for (i = 0; i < d->n_samp; i++)
+    v->w[i] = w[i];
+  DesignPrior(v, A0, beta0);
+  DesignCross(v, v->w, v->XX);
+  return v;
+} /* end of DesignView */
+
+
+/* The # of units: the sum of the row weights */
+double DesignUnits(colDesign *d) {
+  int i;
+  double n = 0;
+
+  if (!d->w)
+    return d->n_samp;
+  for (i = 0; i < d->n_samp; i++)
+    n += d->w[i];
+  return n;
+} /* end of DesignUnits */
+
+
+/* Update X'X after the sampler has overwritten dense column j of X */
+void DesignColumn(colDesign *d, int j) {
+  int i, k, n = d->n_cov;
+  double *x;
+  float *xj;
+
+  if (j >= d->n_dense)
+    error("DesignColumn: column %d is not dense.\n", j+1);
+  if (d->Xf) {
+    x = DesignCol(d, j);
+    xj = d->Xf + (size_t)j*d->n_samp;
+    for (i = 0; i < d->n_samp; i++)
+      xj[i] = (float)x[i];
+  }
+  if (!d->A0)
+    return;
+  if (d->w) { /* X'(w * x_j) */
+    x = doubleArray(d->n_samp);
+    for (i = 0; i < d->n_samp; i++)
+      x[i] = d->w[i]*DesignElt(d, i, j);
+    DesignDenseXty(d, d->n_dense, x, d->XX + (size_t)j*n);
+    free(x);
+  } else if (d->Xf) {
+    xj = d->Xf + (size_t)j*d->n_samp;
+    for (k = 0; k < d->n_dense; k++)
+      d->XX[k+j*n] = DesignDotf(d->Xf + (size_t)k*d->n_samp, xj,
+				d->n_samp);
+  } else
+    DesignDenseXty(d, d->n_dense, DesignCol(d, j), d->XX + (size_t)j*n);
+  for (k = d->n_dense; k < n; k++)
+    d->XX[k+j*n] = DesignSparseDot(d, d->w, k-d->n_dense, j);
+  for (k = 0; k < n; k++)
+    d->XX[j+k*n] = d->XX[k+j*n];
+} /* end of DesignColumn */
+
+
+/* Change the weight of row i to w; its covariates must be dense */
+void DesignRowWeight(colDesign *d, int i, double w) {
+  int j, k, n = d->n_cov;
+  double dw = w - d->w[i], xj;
+
+  if (d->n_dense < n)
+    error("DesignRowWeight: the design has sparse columns.\n");
+  if (dw == 0)
+    return;
+  for (j = 0; j < n; j++) {
+    xj = dw*DesignElt(d, i, j);
+    if (xj != 0)
+      for (k = 0; k < n; k++)
+	d->XX[k+j*n] += xj*DesignElt(d, i, k);
+  }
+  d->w[i] = w;
+} /* end of DesignRowWeight */
+
+
+/* Change the weights of all the rows to w; X'WX is updated by the
+   changed rows only, unless the design has sparse columns */
+void DesignWeights(colDesign *d, double *w) {
+  int i;
+
+  if (d->n_dense < d->n_cov) {
+    for (i = 0; i < d->n_samp; i++)
+      d->w[i] = w[i];
+    DesignCross(d, d->w, d->XX);
+  } else
+    for (i = 0; i < d->n_samp; i++)
+      if (w[i] != d->w[i])
+	DesignRowWeight(d, i, w[i]);
+} /* end of DesignWeights */
+
+
+/* Set element (i, j) of X to x and update X'X by the change of row i,
+   whose covariates must be dense; this costs O(n_cov) rather than the
+   pass over the data of DesignColumn */
+void DesignSetElt(colDesign *d, int i, int j, double x) {
+  int k, n = d->n_cov;
+  double dx = x - DesignElt(d, i, j), w = DesignW(d->w, i);
+
+  if (d->n_dense < n)
+    error("DesignSetElt: the design has sparse columns.\n");
+  if (dx == 0)
+    return;
+  for (k = 0; k < n; k++)
+    if (k != j) {
+      d->XX[k+j*n] += w*dx*DesignElt(d, i, k);
+      d->XX[j+k*n] = d->XX[k+j*n];
+    }
+  d->XX[j+j*n] += w*dx*(2*DesignElt(d, i, j) + dx);
+  DesignCol(d, j)[i] = x;
+  if (d->Xf)
+    d->Xf[i+(size_t)j*d->n_samp] = (float)x;
+} /* end of DesignSetElt */
+
+
+/* Linear predictor of columns from, ..., to-1 of X:
+   eta = X[, from:(to-1)] %*% beta[from:(to-1)] */
+void DesignXBeta(colDesign *d, int from, int to, double *beta,
+		 double *eta) {
+  int i, j, l, hi = to < d->n_dense ? to : d->n_dense;
+  int lo = from > d->n_lead ? from : d->n_lead, n_col = hi - lo;
+  double one = 1, zero = 0;
+  int ione = 1;
+  double *x;
+  float *xj;
+
+  /* dense columns: those of X by dgemv, unless in single precision,
+     and those of T one by one */
+  if (n_col > 0 && !d->Xf)
+    F77_CALL(dgemv)("N", &(d->n_samp), &n_col, &one,
+		    d->X + (size_t)(lo-d->n_lead)*d->n_samp, &(d->n_samp),
+		    beta + lo, &ione, &zero, eta, &ione FCONE);
+  else
+    for (i = 0; i < d->n_samp; i++)
+      eta[i] = 0;
+  for (j = from; j < hi; j++)
+    if (d->Xf) {
+      xj = d->Xf + (size_t)j*d->n_samp;
+      for (i = 0; i < d->n_samp; i++)
+	eta[i] += beta[j]*xj[i];
+    } else if (j < d->n_lead) {
+      x = DesignCol(d, j);
+      for (i = 0; i < d->n_samp; i++)
+	eta[i] += beta[j]*x[i];
+    }
+
+  /* sparse columns */
+  for (j = (from > d->n_dense ? from : d->n_dense); j < to; j++)
+    for (l = d->sp_p[j-d->n_dense]; l < d->sp_p[j-d->n_dense+1]; l++)
+      eta[d->sp_i[l]] += beta[j]*d->sp_x[l];
+} /* end of DesignXBeta */
+
+
+/* Xy = X'y */
+void DesignXty(colDesign *d, double *y, double *Xy) {
+  int j, l;
+
+  DesignDenseXty(d, d->n_dense, y, Xy);
+  for (j = d->n_dense; j < d->n_cov; j++) {
+    Xy[j] = 0;
+    for (l = d->sp_p[j-d->n_dense]; l < d->sp_p[j-d->n_dense+1]; l++)
+      Xy[j] += d->sp_x[l]*y[d->sp_i[l]];
+  }
+} /* end of DesignXty */
+
+
+/* The nonzeros of column j: their rows in idx and values in x, each
+   of length n_samp at most; returns their # */
+int DesignNonzero(colDesign *d, int j, int *idx, double *x) {
+  int i, l, m = 0;
+  double xi;
+
+  if (j < d->n_dense)
+    for (i = 0; i < d->n_samp; i++) {
+      xi = DesignElt(d, i, j);
+      if (xi != 0) {
+	idx[m] = i;
+	x[m++] = xi;
+      }
+    }
+  else
+    for (l = d->sp_p[j-d->n_dense]; l < d->sp_p[j-d->n_dense+1]; l++) {
+      idx[m] = d->sp_i[l];
+      x[m++] = d->sp_x[l];
+    }
+  return m;
+} /* end of DesignNonzero */
+
+
+/* Row i of X, e.g., for the few rows evaluated by a subsampling move;
+   the sparse columns are searched by bisection, since their row
+   indices are increasing */
+void DesignRow(colDesign *d, int i, double *x) {
+  int j, lo, hi, mid;
+
+  for (j = 0; j < d->n_dense; j++)
+    x[j] = DesignElt(d, i, j);
+  for (j = d->n_dense; j < d->n_cov; j++) {
+    x[j] = 0;
+    lo = d->sp_p[j-d->n_dense];
+    hi = d->sp_p[j-d->n_dense+1];
+    while (lo < hi) {
+      mid = (lo+hi)/2;
+      if (d->sp_i[mid] < i)
+	lo = mid+1;
+      else
+	hi = mid;
+    }
+    if (lo < d->sp_p[j-d->n_dense+1] && d->sp_i[lo] == i)
+      x[j] = d->sp_x[lo];
+  }
+} /* end of DesignRow */
+
+
+/* The SWEEP matrix [X'X X'y; y'X y'y] of the regression of y on X
+   with the prior added; the rows of weight 0, e.g., in a view, should
+   have y = 0 */
+void DesignSS(colDesign *d, double *y, double **SS) {
+  int i, j, k, n = d->n_cov;
+
+  DesignXty(d, y, d->Xy);
+  for (j = 0; j < n; j++) {
+    for (k = 0; k < n; k++)
+      SS[j][k] = d->XX[j+k*n] + d->A0[j+k*n];
+    SS[j][n] = SS[n][j] = d->Xy[j] + d->A0b0[j];
+  }
+  SS[n][n] = d->b0A0b0;
+  for (i = 0; i < d->n_samp; i++)
+    SS[n][n] += y[i]*y[i];
+} /* end of DesignSS */
+
+
+void DesignClose(colDesign *d) {
+  free(d->XX);
+  free(d->A0b0);
+  free(d->Xy);
+  if (d->view)
+    free(d->w);
+  else
+    free(d->Xf);
+  free(d);
+} /* end of DesignClose */
@@ -0,0 +1,49 @@
+/* design matrix kept in R's column-major layout; the samplers read it
+   in place instead of copying it into row pointers.  In single
+   precision, the passes over the data read a float copy of X and
+   accumulate in double.  The columns after the first n_dense ones may
+   be stored as compressed sparse columns, e.g., one-hot dummies.  The
+   first n_lead dense columns, which the sampler overwrites, may be
+   kept in a buffer of their own, so that X is never written.  A row
+   may stand for several identical units, given by its weight. */
+typedef struct {
+  double *X;       /* n_samp by n_dense - n_lead, column-major */
+  double *T;       /* n_samp by n_lead: the first n_lead dense
+		      columns; NULL if n_lead == 0 */
+  int n_lead;      /* # of columns in T */
+  float *Xf;       /* float copy of T and X, n_samp by n_dense; NULL
+		      in double precision */
+  int n_samp;      /* # of obs */
+  int n_cov;       /* # of covariates */
+  int n_dense;     /* # of dense covariates */
+  int *sp_p;       /* sparse covariates: column pointers, */
+  int *sp_i;       /* row indices (0-based), */
+  double *sp_x;    /* and values; unused if n_dense == n_cov */
+  double *w;       /* # of units in each row; NULL if one each */
+  double *XX;      /* X'WX, n_cov by n_cov, W = diag(w) */
+  double *A0;      /* prior precision, n_cov by n_cov */
+  double *A0b0;    /* A0 %*% beta0 */
+  double b0A0b0;   /* beta0' A0 beta0 */
+  double *Xy;      /* workspace for X'y */
+  int view;        /* Xf belongs to another design, and w to this one */
+} colDesign;
+
+colDesign *DesignOpen(double *X, int n_samp, int n_cov, int n_dense,
+		      double *T, int n_lead, int *sp_p, int *sp_i,
+		      double *sp_x, double *w, double *A0, double *beta0,
+		      int single);
+colDesign *DesignView(colDesign *d, double *w, double *A0,
+		      double *beta0);
+double DesignUnits(colDesign *d);
+void DesignCross(colDesign *d, double *v, double *XX);
+void DesignColumn(colDesign *d, int j);
+void DesignRowWeight(colDesign *d, int i, double w);
+void DesignWeights(colDesign *d, double *w);
+void DesignSetElt(colDesign *d, int i, int j, double x);
+void DesignXBeta(colDesign *d, int from, int to, double *beta,
+		 double *eta);
+void DesignXty(colDesign *d, double *y, double *Xy);
+int DesignNonzero(colDesign *d, int j, int *idx, double *x);
+void DesignRow(colDesign *d, int i, double *x);
+void DesignSS(colDesign *d, double *y, double **SS);
+void DesignClose(colDesign *d);
@@ -1,4 +1,6 @@
 #include <stdlib.h> // for NULL
+#include <R.h>
+#include <Rinternals.h>
 #include <R_ext/Rdynload.h>
 
 /* FIXME: 
@@ -6,27 +8,67 @@ Check these declarations against the C/Fortran source code.
 */
 
 /* .C calls */
-extern void LIbinary(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
-extern void LIcount(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
-extern void LIgaussian(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
-extern void LIordinal(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
-extern void LItwopart(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
-extern void MARprobit(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
-extern void NIbprobit(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
+extern void MonSize(void *);
+extern void ProfSize(void *);
+extern void SketchSize(void *);
+
+/* .Call calls */
+extern SEXP LIbinaryCall(SEXP);
+extern SEXP LIbprobitMixedCall(SEXP);
+extern SEXP LIboprobitMixedCall(SEXP);
+extern SEXP LIcountCall(SEXP);
+extern SEXP LIgaussianCall(SEXP);
+extern SEXP LINegBinMixedCall(SEXP);
+extern SEXP LINormalMixedCall(SEXP);
+extern SEXP LIordinalCall(SEXP);
+extern SEXP LItwopartCall(SEXP);
+extern SEXP LItwopartMixedCall(SEXP);
+extern SEXP MARprobitCall(SEXP);
+extern SEXP NIbprobitCall(SEXP);
+extern SEXP NIbprobitMixedCall(SEXP);
+extern SEXP atopBootCall(SEXP);
+extern SEXP aupecStatCall(SEXP);
+extern SEXP boundsAggCall(SEXP);
+extern SEXP boundsBootCall(SEXP);
+extern SEXP boundsSupCall(SEXP);
+extern SEXP cadeRegMeatCall(SEXP);
+extern SEXP clusterMomentsCall(SEXP);
+extern SEXP papeStatCall(SEXP);
 
 static const R_CMethodDef CEntries[] = {
-  {"LIbinary",   (DL_FUNC) &LIbinary,   44},
-  {"LIcount",    (DL_FUNC) &LIcount,    48},
-  {"LIgaussian", (DL_FUNC) &LIgaussian, 46},
-  {"LIordinal",  (DL_FUNC) &LIordinal,  46},
-  {"LItwopart",  (DL_FUNC) &LItwopart,  49},
-  {"MARprobit",  (DL_FUNC) &MARprobit,  28},
-  {"NIbprobit",  (DL_FUNC) &NIbprobit,  25},
+  {"MonSize",    (DL_FUNC) &MonSize,    1},
+  {"ProfSize",   (DL_FUNC) &ProfSize,   1},
+  {"SketchSize", (DL_FUNC) &SketchSize, 1},
+  {NULL, NULL, 0}
+};
+
+static const R_CallMethodDef CallEntries[] = {
+  {"LIbinaryCall",        (DL_FUNC) &LIbinaryCall,        1},
+  {"LIbprobitMixedCall",  (DL_FUNC) &LIbprobitMixedCall,  1},
+  {"LIboprobitMixedCall", (DL_FUNC) &LIboprobitMixedCall, 1},
+  {"LIcountCall",         (DL_FUNC) &LIcountCall,         1},
+  {"LIgaussianCall",      (DL_FUNC) &LIgaussianCall,      1},
+  {"LINegBinMixedCall",   (DL_FUNC) &LINegBinMixedCall,   1},
+  {"LINormalMixedCall",   (DL_FUNC) &LINormalMixedCall,   1},
+  {"LIordinalCall",       (DL_FUNC) &LIordinalCall,       1},
+  {"LItwopartCall",       (DL_FUNC) &LItwopartCall,       1},
+  {"LItwopartMixedCall",  (DL_FUNC) &LItwopartMixedCall,  1},
+  {"MARprobitCall",       (DL_FUNC) &MARprobitCall,       1},
+  {"NIbprobitCall",       (DL_FUNC) &NIbprobitCall,       1},
+  {"NIbprobitMixedCall",  (DL_FUNC) &NIbprobitMixedCall,  1},
+  {"atopBootCall",        (DL_FUNC) &atopBootCall,        1},
+  {"aupecStatCall",       (DL_FUNC) &aupecStatCall,       1},
+  {"boundsAggCall",       (DL_FUNC) &boundsAggCall,       1},
+  {"boundsBootCall",      (DL_FUNC) &boundsBootCall,      1},
+  {"boundsSupCall",       (DL_FUNC) &boundsSupCall,       1},
+  {"cadeRegMeatCall",     (DL_FUNC) &cadeRegMeatCall,     1},
+  {"clusterMomentsCall",  (DL_FUNC) &clusterMomentsCall,  1},
+  {"papeStatCall",        (DL_FUNC) &papeStatCall,        1},
   {NULL, NULL, 0}
 };
 
 void R_init_experiment(DllInfo *dll)
 {
-  R_registerRoutines(dll, CEntries, NULL, NULL, NULL);
+  R_registerRoutines(dll, CEntries, CallEntries, NULL, NULL);
   R_useDynamicSymbols(dll, FALSE);
 }
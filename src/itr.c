@@ -0,0 +1,343 @@
+/****
+
+     This file contains the evaluation of individualized treatment
+     rules (ITRs) from a randomized experiment.
+
+     AUPEC: the area under the prescriptive effect curve of a score
+     tau and its variance.  The rules treat the units whose score is
+     above a quantile of tau, so each of them treats the top units of
+     the ranking by tau.  After a single sort, the means of the
+     outcomes of the treated and control units above or below each
+     cutoff are read from prefix sums along the ranking, which costs
+     O(n log n) instead of a pass over the data for each of the n
+     cutoffs.  The covariance terms, sums over pairs of cutoffs, are
+     cumulative sums, and their average over the binomial # of units
+     treated by the rule is computed exactly rather than over random
+     draws.
+
+     PAPE and PAPD: the estimates depend on the rule only through the
+     counts and sums of the outcomes of the units by treatment and
+     prescription, and the variances of the outcomes weighted by the
+     prescription within each treatment group.
+
+     Many rules (or scores) are evaluated against the same experiment
+     as the columns of a matrix, which are split among threads.
+
+****/
+
+#include <stdlib.h>
+#include <float.h>
+#include <R.h>
+#include <Rmath.h>
+#include "vector.h"
+#include "samplers.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+/* quantile of type 7 (the default of quantile()) of the sorted x */
+static double Quantile7(double *x, int n, double p) {
+  double index = 1 + (n-1)*p, h;
+  int lo = (int)floor(index + 4*DBL_EPSILON);
+
+  if (lo < 1)
+    lo = 1;
+  if (lo >= n)
+    return x[n-1];
+  h = index - lo;
+  if (h <= 0 || x[lo] == x[lo-1])
+    return x[lo-1];
+  return (1-h)*x[lo-1] + h*x[lo];
+}
+
+
+/* # of elements of the sorted x which are c or less */
+static int CountLE(double *x, int n, double c) {
+  int lo = 0, hi = n, mid;
+
+  while (lo < hi) {
+    mid = (lo + hi)/2;
+    if (x[mid] <= c)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+
+/* difference in the means of the treated and control outcomes from
+   their sums and counts; NaN if either group is empty */
+static double MeanDiff(double s1, double n1, double s0, double n0) {
+  if (n1 == 0 || n0 == 0)
+    return R_NaN;
+  return s1/n1 - s0/n0;
+}
+
+
+/* sample variance of d*Y among the units of treatment group t; NA
+   if there are less than two of them */
+static double ArmVar(double *d, int *T, double *Y, int n, int t) {
+  int i, m = 0;
+  double x, mean = 0, ss = 0;
+
+  for (i = 0; i < n; i++)
+    if (T[i] == t) {
+      mean += d[i]*Y[i];
+      m++;
+    }
+  if (m < 2)
+    return NA_REAL;
+  mean /= m;
+  for (i = 0; i < n; i++)
+    if (T[i] == t) {
+      x = d[i]*Y[i] - mean;
+      ss += x*x;
+    }
+  return ss/(m-1);
+}
+
+
+/* AUPEC of the score tau: ThatfA gets the share of the rules treating
+   each unit, and stat the sums of T ThatfA Y and (1-T) ThatfA Y, the
+   variances of (ThatfA - 1/2) Y among the treated and control units,
+   and the two covariance terms.  dwork holds AUPEC_DWORK(n) doubles
+   and iwork AUPEC_IWORK(n) integers of scratch. */
+#define AUPEC_DWORK(n) (11*(size_t)(n) + 11)
+#define AUPEC_IWORK(n) (2*(size_t)(n) + 1)
+
+static void AupecCol(double *tau, int *T, double *Y, int n,
+		     double *ThatfA, double *stat, double *dwork,
+		     int *iwork) {
+  int i, j, k, m, z;
+  double c, w, pz, g, h, pf = 0, eh = 0, eh2 = 0, dn = (double)n;
+  double *s = dwork;
+  int *idx = iwork, *cnt = iwork + n;
+  /* prefix sums along the ranking: T*Y, T, (1-T)*Y, (1-T) */
+  double *p1y = s + n, *p1 = p1y + (n+1);
+  double *p0y = p1 + (n+1), *p0 = p0y + (n+1);
+  /* kAf1[j], kAf0[j] for j = 1, ..., n */
+  double *kAf1 = p0 + (n+1), *kAf0 = kAf1 + (n+2);
+  double *st1 = kAf0 + (n+1), *st2 = st1 + (n+1);
+  double *st3 = st2 + (n+1), *stM = st3 + (n+1);
+
+  for (i = 0; i < n; i++) {
+    s[i] = tau[i];
+    idx[i] = i;
+    if (tau[i] > 0)
+      pf++;
+  }
+  pf /= dn;
+  rsort_with_index(s, idx, n);
+  p1y[0] = 0; p1[0] = 0; p0y[0] = 0; p0[0] = 0;
+  for (i = 0; i < n; i++) {
+    j = idx[i];
+    p1y[i+1] = p1y[i] + T[j]*Y[j];
+    p1[i+1] = p1[i] + T[j];
+    p0y[i+1] = p0y[i] + (1-T[j])*Y[j];
+    p0[i+1] = p0[i] + (1-T[j]);
+  }
+  for (i = 0; i <= n; i++)
+    cnt[i] = 0;
+
+  /* the rule of cutoff i treats the k units with tau above the
+     quantile 1-i/n, those of kAf1 the m units above (i-1)/n */
+  kAf1[n+1] = NA_REAL;
+  kAf0[0] = NA_REAL;
+  for (i = 1; i <= n; i++) {
+    c = Quantile7(s, n, 1-(double)i/n);
+    k = n - CountLE(s, n, c);
+    cnt[CountLE(s, n, c > 0 ? c : 0)]++;
+    c = Quantile7(s, n, (double)(i-1)/n);
+    m = n - CountLE(s, n, c);
+    w = MeanDiff(p1y[n]-p1y[n-m], p1[n]-p1[n-m], p0y[n]-p0y[n-m],
+		 p0[n]-p0[n-m]);
+    kAf1[n-i+1] = ISNAN(w) ? kAf1[n-i+2] : w;
+    w = MeanDiff(p1y[n-k], p1[n-k], p0y[n-k], p0[n-k]);
+    kAf0[i] = ISNAN(w) ? kAf0[i-1] : w;
+  }
+
+  /* share of the rules treating the unit of each rank */
+  for (i = 0, k = 0; i < n; i++) {
+    k += cnt[i];
+    ThatfA[idx[i]] = k/dn;
+  }
+
+  /* cumulative sums of the covariance terms: with A[j] = j kAf1[j],
+     B[j] = (n-j) kAf1[j], and C[j] = (n-j) kAf0[j], st1 = cumsum(A C),
+     st2 = cumsum(A), st3 = cumsum(A B), and stM = cumsum of the
+     column sums of the upper triangle of outer(A, B) */
+  st1[0] = 0; st2[0] = 0; st3[0] = 0; stM[0] = 0;
+  for (j = 1; j <= n; j++) {
+    st1[j] = st1[j-1] + j*kAf1[j]*(n-j)*kAf0[j];
+    st2[j] = st2[j-1] + j*kAf1[j];
+    st3[j] = st3[j-1] + j*kAf1[j]*(n-j)*kAf1[j];
+    stM[j] = stM[j-1] + (n-j)*kAf1[j]*st2[j-1];
+  }
+
+  /* their expectations over Z ~ Binomial(n, pf), given Z > 0 */
+  stat[4] = 0;
+  w = 1 - dbinom(0, dn, pf, 0);
+  for (z = 1; z <= n; z++) {
+    pz = dbinom((double)z, dn, pf, 0)/w;
+    if (pz == 0)
+      continue;
+    g = -st1[z]/(dn*dn*dn*(dn-1))
+      - z*(dn-z)*(dn-z)/(dn*dn*dn*(dn-1))*kAf1[z]*kAf0[z]
+      - 2*stM[z]/(dn*dn*dn*dn*(dn-1))
+      - (double)z*z*(dn-z)*(dn-z)/(dn*dn*dn*dn*(dn-1))*kAf1[z]*kAf1[z]
+      - 2*(dn-z)*(dn-z)/(dn*dn*dn*dn*(dn-1))*kAf1[z]*st2[z]
+      + st3[z]/(dn*dn*dn*dn);
+    h = (st2[z]/dn + (dn-z)*z/dn*kAf1[z])/dn;
+    stat[4] += pz*g;
+    eh += pz*h;
+    eh2 += pz*h*h;
+  }
+  stat[5] = eh2 - eh*eh;
+  if (w == 0)
+    stat[4] = stat[5] = R_NaN;
+
+  stat[0] = 0; stat[1] = 0;
+  for (i = 0; i < n; i++) {
+    if (T[i])
+      stat[0] += ThatfA[i]*Y[i];
+    else
+      stat[1] += ThatfA[i]*Y[i];
+    ThatfA[i] -= 0.5;
+  }
+  stat[2] = ArmVar(ThatfA, T, Y, n, 1);
+  stat[3] = ArmVar(ThatfA, T, Y, n, 0);
+} /* end of AupecCol */
+
+
+void aupecStat(double *tau,    /* n by m scores */
+	       int *T,         /* treatment: 0 or 1 */
+	       double *Y,      /* outcome */
+	       int *n_samp,    /* # of units: n */
+	       int *n_rule,    /* # of scores: m */
+	       int *n_thread,  /* # of threads */
+	       double *stat    /* 6 by m statistics of AupecCol */
+	       ) {
+  int i, j, n = *n_samp, n_th = *n_thread > 1 ? *n_thread : 1;
+  size_t n_dwork = AUPEC_DWORK(n) + n, n_iwork = AUPEC_IWORK(n);
+  double *dwork;
+  int *iwork;
+
+  /* T indexes the prefix sums, so NA must not get through */
+  for (i = 0; i < n; i++)
+    if (T[i] != 0 && T[i] != 1)
+      error("aupecStat: T should be 0 or 1.\n");
+
+  /* scratch of each thread, allocated here since error() must not be
+     raised inside the parallel region */
+  dwork = doubleArray(n_th*n_dwork);
+  iwork = intArray(n_th*n_iwork);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(n_th) if (n_th > 1)
+#endif
+  {
+#ifdef _OPENMP
+    int t = omp_get_thread_num();
+#else
+    int t = 0;
+#endif
+    double *work = dwork + t*n_dwork;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (j = 0; j < *n_rule; j++)
+      AupecCol(tau + (size_t)j*n, T, Y, n, work, stat + 6*j, work + n,
+	       iwork + t*n_iwork);
+  }
+
+  free(dwork);
+  free(iwork);
+} /* end of aupecStat */
+
+
+/* PAPE and PAPD of the binary rules H: stat gets, for each rule, the
+   counts and the sums of the outcomes of the units by treatment t and
+   prescription h (at t + 2h), those of the treated and control units
+   prescribed the treatment by the rule G, and the variances of
+   (H - G) Y among the treated and control units.  Without G, the
+   variances are those of (H - p) Y, where p is the share of the units
+   prescribed the treatment if NA. */
+void papeStat(int *T,         /* treatment: 0 or 1 */
+	      double *Y,      /* outcome */
+	      int *H,         /* n by m rules: 0 or 1 */
+	      int *G,         /* n by m rules compared, if has_g */
+	      int *n_samp,    /* # of units: n */
+	      int *n_rule,    /* # of rules: m */
+	      int *has_g,
+	      double *plim,   /* p */
+	      int *n_thread,  /* # of threads */
+	      double *stat    /* 14 by m statistics */
+	      ) {
+  int i, j, k, l, n = *n_samp, n_th = *n_thread > 1 ? *n_thread : 1;
+  double *dwork;
+
+  /* T, H and G index the counts, so NA must not get through */
+  for (i = 0; i < n; i++)
+    if (T[i] != 0 && T[i] != 1)
+      error("papeStat: T should be 0 or 1.\n");
+  for (j = 0; j < *n_rule; j++)
+    for (i = 0; i < n; i++) {
+      k = H[i+(size_t)j*n];
+      l = *has_g ? G[i+(size_t)j*n] : 0;
+      if ((k != 0 && k != 1) || (l != 0 && l != 1))
+	error("papeStat: the rules should be 0 or 1.\n");
+    }
+
+  /* d of each thread, allocated here since error() must not be raised
+     inside the parallel region */
+  dwork = doubleArray(n_th*n);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(n_th) if (n_th > 1)
+#endif
+  {
+    int i, k;
+    int *h, *g;
+#ifdef _OPENMP
+    double p, *st, *d = dwork + (size_t)omp_get_thread_num()*n;
+#else
+    double p, *st, *d = dwork;
+#endif
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (j = 0; j < *n_rule; j++) {
+      h = H + (size_t)j*n;
+      g = *has_g ? G + (size_t)j*n : NULL;
+      st = stat + 14*j;
+      for (k = 0; k < 12; k++)
+	st[k] = 0;
+      for (i = 0; i < n; i++) {
+	k = T[i] + 2*h[i];
+	st[k]++;
+	st[4+k] += Y[i];
+	if (*has_g && g[i]) {
+	  st[8+T[i]]++;
+	  st[10+T[i]] += Y[i];
+	}
+      }
+      if (*has_g)
+	for (i = 0; i < n; i++)
+	  d[i] = h[i] - g[i];
+      else {
+	p = ISNAN(*plim) ? (st[2] + st[3])/n : *plim;
+	for (i = 0; i < n; i++)
+	  d[i] = h[i] - p;
+      }
+      st[12] = ArmVar(d, T, Y, n, 1);
+      st[13] = ArmVar(d, T, Y, n, 0);
+    }
+  }
+
+  free(dwork);
+} /* end of papeStat */
@@ -76,11 +76,11 @@ void bNormalReg(double **D,    /* data [X Y] */
   if (!sig2fixed) {
     if (psig2) {  /* proper prior for sig2 */
       if (pbeta)   /* proper prior for beta */
-	sig2[0]=(SS[n_cov][n_cov]+nu0*s0)/rchisq((double)n_samp+nu0);
+	sig2[0]=(SS[n_cov][n_cov]+nu0*s0)/rchisq(n_samp+nu0);
        else        /* improper prior for beta */
-	sig2[0]=(n_samp*SS[n_cov][n_cov]/(n_samp-n_cov)+nu0*s0)/rchisq((double)n_samp+nu0);
+	sig2[0]=(n_samp*SS[n_cov][n_cov]/(n_samp-n_cov)+nu0*s0)/rchisq(n_samp+nu0);
     } else         /* improper prior for sig2 */
-      sig2[0]=SS[n_cov][n_cov]/rchisq((double)n_samp-n_cov);
+      sig2[0]=SS[n_cov][n_cov]/rchisq(n_samp-n_cov);
   }
 
   /* draw beta from its conditional given sig2 */
@@ -96,6 +96,47 @@ void bNormalReg(double **D,    /* data [X Y] */
 }
 
 
+/* The same draw on a column-major design (see design.c), which holds
+   the prior; Y is the outcome of each row.  The rows may be weighted
+   by 0 or 1, e.g., in a view of the units with observed outcomes,
+   and those of weight 0 should have Y = 0 */
+void bNormalRegCol(double *Y, colDesign *d, double *beta, double *sig2,
+		   int pbeta, int psig2, double s0, int nu0, int sig2fixed) {
+  int j, k, n_cov = d->n_cov;
+  double n_samp = DesignUnits(d);
+  double **SS = doubleMatrix(n_cov+1, n_cov+1); /* matrix folders for SWEEP */
+  double *mean = doubleArray(n_cov);            /* means for beta */
+  double **V = doubleMatrix(n_cov, n_cov);      /* variances for beta */
+
+  /* SWEEP SS matrix */
+  DesignSS(d, Y, SS);
+  for(j = 0; j < n_cov; j++)
+    SWP(SS, j, n_cov+1);
+
+  /* draw sig2 from its marginal dist */
+  for(j = 0; j < n_cov; j++)
+    mean[j] = SS[j][n_cov];
+  if (!sig2fixed) {
+    if (psig2) {  /* proper prior for sig2 */
+      if (pbeta)   /* proper prior for beta */
+	sig2[0]=(SS[n_cov][n_cov]+nu0*s0)/rchisq(n_samp+nu0);
+       else        /* improper prior for beta */
+	sig2[0]=(n_samp*SS[n_cov][n_cov]/(n_samp-n_cov)+nu0*s0)/rchisq(n_samp+nu0);
+    } else         /* improper prior for sig2 */
+      sig2[0]=SS[n_cov][n_cov]/rchisq(n_samp-n_cov);
+  }
+
+  /* draw beta from its conditional given sig2 */
+  for(j = 0; j < n_cov; j++)
+    for(k = 0; k < n_cov; k++) V[j][k]=-SS[j][k]*sig2[0];
+  rMVN(beta, mean, V, n_cov);
+
+  free(mean);
+  FreeMatrix(SS, n_cov+1);
+  FreeMatrix(V, n_cov);
+} /* end of bNormalRegCol */
+
+
 /*** 
    A Gibbs Sampler for Binary Probit Regression With and Without
    Marginal Data Augmentation
@@ -205,7 +246,164 @@ void bprobitGibbs(int *Y,        /* binary outcome variable */
 }
 
 
-/*** 
+/***
+   The same sampler on a column-major design (see design.c), whose
+   X'X is computed once rather than at every draw; the prior is
+   always included.  When the rows of the design are weighted, row i
+   stands for d->w[i] units of which Y[i] are ones; only the sum and
+   sum of squares of their latent variables enter the cross-products,
+   and these are drawn directly for rows of many units (see
+   bprobitLatent).
+***/
+
+void bprobitGibbsCol(int *Y,         /* binary outcome variable, or
+					# of ones in each row */
+		     colDesign *d,   /* covariates and prior */
+		     double *beta,   /* coefficients */
+		     int mda,        /* marginal data augmentation? */
+		     int n_gen       /* # of gibbs draws */
+		     ) {
+  int n_samp = d->n_samp;
+  double *W = doubleArray(n_samp);              /* latent variable */
+
+  /* storage parameters and loop counters */
+  int i, k, n_unit, main_loop;
+  double WW;
+
+  /* marginal data augmentation */
+  double sig2 = 1;
+  int nu0 = 1;
+  double s0 = 1;
+
+  /* Gibbs Sampler! */
+  for(main_loop = 1; main_loop <= n_gen; main_loop++){
+    /* marginal data augmentation */
+    if (mda) sig2 = s0/rchisq((double)nu0);
+
+    DesignXBeta(d, 0, d->n_cov, beta, W);
+    n_unit = 0;
+    WW = 0;
+    for (i = 0; i < n_samp; i++){
+      k = d->w ? (int)d->w[i] : 1;
+      W[i] = bprobitLatent(W[i], k, Y[i], sig2, &WW);
+      n_unit += k;
+    }
+    bprobitDrawCol(d, W, WW, n_unit, beta, mda, sig2);
+    R_CheckUserInterrupt();
+  } /* end of Gibbs sampler */
+
+  /* freeing memory */
+  free(W);
+} /* end of bprobitGibbsCol */
+
+
+#define LATENT_EXACT 30 /* blocks of more units draw the sums of their
+			   latent variables, not each of them */
+
+/* Latent variables of m units with mean eta, all ones (one = 1) or
+   all zeros, scaled by sqrt(sig2); their sum is added to W and their
+   sum of squares to WW.  With z = eta + u (ones) or eta - u (zeros),
+   u is a standard normal truncated below at a.  For m > LATENT_EXACT,
+   sum(u) and sum((u - E u)^2) are drawn from their bivariate normal
+   approximation, given the first four moments of u, and redrawn
+   until they are attainable.  Smaller blocks, and those so far in the
+   tail that these moments lose their precision, are drawn unit by
+   unit. */
+static void bprobitBlock(double eta, int m, int one, double sig2,
+			 double *W, double *WW) {
+  int l;
+  double z, a, h, M1 = 0, M2, M3, M4, v = 0, c3 = 0, vd = 0, U1, V2;
+
+  a = one ? -eta : eta;
+  if (m > LATENT_EXACT) {
+    /* moments of u; the variance and third central moment of u, and
+       the residual variance of (u - M1)^2 given u */
+    h = exp(dnorm(a, 0, 1, 1) - pnorm(a, 0, 1, 0, 1));
+    M1 = h; M2 = 1 + a*h; M3 = 2*M1 + a*a*h; M4 = 3*M2 + a*a*a*h;
+    v = M2 - M1*M1;
+    c3 = M3 - 3*M1*M2 + 2*M1*M1*M1;
+    vd = M4 - 4*M1*M3 + 6*M1*M1*M2 - 3*M1*M1*M1*M1 - v*v - c3*c3/v;
+  }
+  if (!(v > 1e-8) || !(vd > 1e-12)) {
+    for (l = 0; l < m; l++) {
+      if (one)
+	z = TruncNorm(0,eta+1000,eta,1,0);
+      else
+	z = TruncNorm(eta-1000,0,eta,1,0);
+      z *= sqrt(sig2);
+      *W += z;
+      *WW += z*z;
+    }
+    return;
+  }
+  /* U1 = sum(u - M1) and V2 = sum((u - M1)^2) */
+  do {
+    U1 = sqrt(m*v)*norm_rand();
+    V2 = m*v + c3/v*U1 + sqrt(m*vd)*norm_rand();
+  } while (U1 <= m*(a - M1) || V2 < U1*U1/m);
+  /* sum(z - eta) and sum((z - eta)^2) */
+  V2 += 2*M1*U1 + m*M1*M1;
+  U1 += m*M1;
+  if (!one)
+    U1 = -U1;
+  *W += sqrt(sig2)*(m*eta + U1);
+  *WW += sig2*(m*eta*eta + 2*eta*U1 + V2);
+} /* end of bprobitBlock */
+
+
+/* Sum of the latent variables of the k units of a row with mean eta,
+   y of which are ones, scaled by sqrt(sig2); their sum of squares is
+   added to WW.  A row of weight k costs at most 2*LATENT_EXACT
+   truncated normal draws (see bprobitBlock) */
+double bprobitLatent(double eta, int k, int y, double sig2, double *WW) {
+  double W = 0;
+
+  /* a row of weight 0, e.g., of a view, has no units at all */
+  if (y > k)
+    y = k;
+  bprobitBlock(eta, k - y, 0, sig2, &W, WW);
+  bprobitBlock(eta, y, 1, sig2, &W, WW);
+  return W;
+} /* end of bprobitLatent */
+
+
+/* One draw of beta given the latent sums W of the rows of d, drawn by
+   bprobitLatent with the same sig2; n_unit is the # of units */
+void bprobitDrawCol(colDesign *d, double *W, double WW, int n_unit,
+		    double *beta, int mda, double sig2) {
+  int j, k, n_cov = d->n_cov;
+  double **SS = doubleMatrix(n_cov+1, n_cov+1); /* matrix folders for SWEEP */
+  double *mean = doubleArray(n_cov);            /* means for beta */
+  double **V = doubleMatrix(n_cov, n_cov);      /* variances for beta */
+  int nu0 = 1;
+  double s0 = 1;
+
+  /* SWEEP SS matrix */
+  DesignSS(d, W, SS);
+  SS[n_cov][n_cov] = d->b0A0b0 + WW;
+  for(j = 0; j < n_cov; j++)
+    SWP(SS, j, n_cov+1);
+
+  /* draw beta */
+  for(j = 0; j < n_cov; j++)
+    mean[j] = SS[j][n_cov];
+  if (mda)
+    sig2=(SS[n_cov][n_cov]+s0)/rchisq((double)n_unit+nu0);
+  for(j = 0; j < n_cov; j++)
+    for(k = 0; k < n_cov; k++) V[j][k]=-SS[j][k]*sig2;
+  rMVN(beta, mean, V, n_cov);
+
+  /* rescaling the parameters */
+  if(mda)
+    for (j = 0; j < n_cov; j++) beta[j] /= sqrt(sig2);
+
+  free(mean);
+  FreeMatrix(SS, n_cov+1);
+  FreeMatrix(V, n_cov);
+} /* end of bprobitDrawCol */
+
+
+/***
    A Gibbs Sampler for Ordinal Probit Regression With and Without
    Marginal Data Augmentation
    
@@ -436,7 +634,7 @@ void logitMetro(int *Y,        /* outcome variable: 0, 1, ..., J-1 */
 	  denom += Xbeta[i][Y[i]-1];
 	  numer += Xbeta1[i][Y[i]-1];
 	} 
-	sumall1[i] += (exp(Xbeta1[i][j])-exp(Xbeta[i][j]));
+	sumall1[i] = sumall[i] + (exp(Xbeta1[i][j])-exp(Xbeta[i][j]));
 	numer -= log(sumall1[i]);
 	denom -= log(sumall[i]);
       }
@@ -449,6 +647,10 @@ void logitMetro(int *Y,        /* outcome variable: 0, 1, ..., J-1 */
 	  sumall[i] = sumall1[i];
 	  Xbeta[i][j] = Xbeta1[i][j];
 	}
+      } else {
+	prop[j*n_cov+k] = beta[j*n_cov+k];
+	for (i = 0; i < n_samp; i++)
+	  Xbeta1[i][j] = Xbeta[i][j];
       }
     }
   }
@@ -461,6 +663,428 @@ void logitMetro(int *Y,        /* outcome variable: 0, 1, ..., J-1 */
 } /* end of logitMetro */
 
 
+/*** 
+   The same sampler on a column-major design (see design.c), whose
+   rows are weighted by 0 or 1 if at all, e.g., a view of the units
+   with observed outcomes; the rows of weight 0 are left out.  A move
+   of beta[j*K+k] only changes the linear predictors of the obs where
+   column k is nonzero, so the likelihood ratio is summed over those
+   obs, e.g., the units of one site dummy, rather than over all of
+   them.
+***/
+void logitMetroCol(int *Y,        /* outcome variable: 0, 1, ..., J-1 */
+		   colDesign *d,  /* (N x K) covariates */
+		   double *beta,  /* (K(J-1)) stacked coefficient vector */
+		   int n_dim,     /* # of categories, J-1 */
+		   double *beta0, /* (K(J-1)) prior mean vector */
+		   double **A0,   /* (K(J-1) x K(J-1)) prior precision */
+		   double *Var,   /* K(J-1) proposal variances */
+		   int n_gen,     /* # of MCMC draws */
+		   int *counter   /* # of acceptance for each parameter */
+		   ) {
+  int n_samp = d->n_samp, n_cov = d->n_cov;
+  int i, j, k, l, n_nz, main_loop;
+  double numer, denom, diff, eta, eta1;
+  double *sumall = doubleArray(n_samp); 
+  double *sumall1 = doubleArray(n_samp);
+  double *prop = doubleArray(n_dim*n_cov);
+  /* linear predictor of category j+1 at [j*n_samp] */
+  double *Xbeta = doubleArray((size_t)n_samp*n_dim);
+  /* nonzeros of the column of the move */
+  int *idx = intArray(n_samp);
+  double *x = doubleArray(n_samp);
+
+  for (i = 0; d->w && i < n_samp; i++)
+    if (d->w[i] != 0 && d->w[i] != 1)
+      error("logitMetroCol: the rows should be weighted by 0 or 1.\n");
+  for (j = 0; j < n_cov*n_dim; j++)
+    prop[j] = beta[j];
+  for (j = 0; j < n_dim; j++)
+    DesignXBeta(d, 0, n_cov, beta + j*n_cov, Xbeta + (size_t)j*n_samp);
+  for (i = 0; i < n_samp; i++) {
+    sumall[i] = 1.0; 
+    for (j = 0; j < n_dim; j++)
+      sumall[i] += exp(Xbeta[i+(size_t)j*n_samp]);
+  }
+
+  for (main_loop = 0; main_loop < n_gen; main_loop++) {
+    for (j = 0; j < n_dim; j++)
+      for (k = 0; k < n_cov; k++) {
+	/** Sample from the proposal distribution **/
+	diff = norm_rand()*sqrt(Var[j*n_cov+k]);
+	prop[j*n_cov+k] = beta[j*n_cov+k] + diff;
+      
+	/** Calculating the ratio (log scale) **/
+	/* prior */
+	numer = dMVN(prop, beta0, A0, n_cov*n_dim, 1);
+	denom = dMVN(beta, beta0, A0, n_cov*n_dim, 1);   
+	/* likelihood of the obs whose linear predictor changes */
+	n_nz = DesignNonzero(d, k, idx, x);
+	for (l = 0; l < n_nz; l++) {
+	  i = idx[l];
+	  if (d->w && d->w[i] == 0)
+	    continue;
+	  eta = Xbeta[i+(size_t)j*n_samp];
+	  eta1 = eta + x[l]*diff;
+	  if (Y[i] == j+1) {
+	    denom += eta;
+	    numer += eta1;
+	  } 
+	  sumall1[i] = sumall[i] + (exp(eta1)-exp(eta));
+	  numer -= log(sumall1[i]);
+	  denom -= log(sumall[i]);
+	}
+      
+	/** Rejection **/
+	if (unif_rand() < fmin2(1.0, exp(numer-denom))) {
+	  counter[j*n_cov+k]++;
+	  beta[j*n_cov+k] = prop[j*n_cov+k];
+	  for (l = 0; l < n_nz; l++) {
+	    i = idx[l];
+	    if (d->w && d->w[i] == 0)
+	      continue;
+	    sumall[i] = sumall1[i];
+	    Xbeta[i+(size_t)j*n_samp] += x[l]*diff;
+	  }
+	} else
+	  prop[j*n_cov+k] = beta[j*n_cov+k];
+      }
+  }
+  
+  free(prop);
+  free(sumall);
+  free(sumall1);
+  free(Xbeta);
+  free(idx);
+  free(x);
+} /* end of logitMetroCol */
+
+
+
+/*** 
+   A Subsampling Version of logitMetro for Large Samples
+
+   Same model, prior and proposals as logitMetro.  Around a reference
+   point r, the log likelihood of unit i is split into its first order
+   Taylor term, whose sum over the units is G'(beta - r) with G the
+   gradient at r, and the remainder phi_i.  A move of beta[j*K+k] by
+   delta is accepted with the factorized probability
+
+     min(1, prior ratio * exp(G[j*K+k]*delta)) *
+       prod_i min(1, exp(phi_i(prop) - phi_i(beta)))
+
+   which leaves the posterior invariant.  Since the second derivatives
+   of a unit's log likelihood with respect to its linear predictors
+   lie in [-1/4, 1/4], unit i rejects the move with rate at most
+
+     c = B_k |delta| sum_{l,m} B_m max(|beta[l*K+m] - r[l*K+m]|,
+                                       |prop[l*K+m] - r[l*K+m]|) / 4
+
+   where B_m = max_i |X[i][m]|.  These rejections are simulated by
+   thinning a Poisson process of rate n*c, so only the units at its
+   points are evaluated; when r is near the posterior mode, n*c is
+   O(1).  When c > 1, the move is accepted or rejected by the usual
+   full likelihood ratio instead; the choice is symmetric in beta and
+   prop.  The linear predictors of this ratio take one pass at the
+   first such move, and are then kept up to date column by column
+   with the moves accepted since, as in logitMetroCol.  r must not
+   depend on beta, e.g., it is held fixed after the
+   burnin.  G and B_m take one pass over the data, which is read in
+   place on a column-major design (see design.c).  As in
+   logitMetroCol, the rows of weight 0 of a view are left out: their
+   phi_i is 0, so they never reject.
+***/
+
+static double logitLik(int y, double *eta, int n_dim) {
+  int j;
+  double sumall = 1.0;
+
+  for (j = 0; j < n_dim; j++)
+    sumall += exp(eta[j]);
+  return (y > 0 ? eta[y-1] : 0) - log(sumall);
+}
+
+void logitMetroSub(int *Y,        /* outcome variable: 0, 1, ..., J-1 */
+		   colDesign *d,  /* (N x K) covariates, weighted by 0
+				     or 1 if at all */
+		   double *beta,  /* (K(J-1)) stacked coefficient vector */
+		   double *ref,   /* (K(J-1)) reference point */
+		   int n_dim,     /* # of categories, J-1 */
+		   double *beta0, /* (K(J-1)) prior mean vector */
+		   double **A0,   /* (K(J-1) x K(J-1)) prior precision */
+		   double *Var,   /* K(J-1) proposal variances */
+		   int n_gen,     /* # of MCMC draws */
+		   int *counter   /* # of acceptance for each parameter */
+		   ) {
+  
+  int n_samp = d->n_samp, n_cov = d->n_cov;
+  int i, j, k, l, m, n_nz, main_loop, n_pois, accept, synced = 0;
+  double numer, denom, diff, rate, sumall, dtemp;
+  double *bound = doubleArray(n_cov);
+  double *grad = doubleArray(n_dim*n_cov);
+  double *prop = doubleArray(n_dim*n_cov);
+  double *eta = doubleArray(n_dim);
+  double *etar = doubleArray(n_dim);
+  double *xi = doubleArray(n_cov);
+  /* linear predictors (or residuals) of category l+1 at [l*n_samp];
+     once synced, the predictors are those at beta1 */
+  double *Xbeta = doubleArray((size_t)n_samp*n_dim);
+  double *beta1 = doubleArray(n_dim*n_cov);
+  /* nonzeros of a column */
+  int *idx = intArray(n_samp);
+  double *x = doubleArray(n_samp);
+
+  for (i = 0; d->w && i < n_samp; i++)
+    if (d->w[i] != 0 && d->w[i] != 1)
+      error("logitMetroSub: the rows should be weighted by 0 or 1.\n");
+
+  /** bounds and the gradient at the reference point **/
+  for (m = 0; m < n_cov; m++) {
+    bound[m] = 0;
+    n_nz = DesignNonzero(d, m, idx, x);
+    for (l = 0; l < n_nz; l++)
+      bound[m] = fmax2(bound[m], fabs(x[l]));
+  }
+  for (j = 0; j < n_cov*n_dim; j++)
+    prop[j] = beta[j];
+  for (l = 0; l < n_dim; l++)
+    DesignXBeta(d, 0, n_cov, ref + l*n_cov, Xbeta + (size_t)l*n_samp);
+  for (i = 0; i < n_samp; i++) {
+    sumall = 1.0;
+    for (l = 0; l < n_dim; l++) {
+      etar[l] = exp(Xbeta[i+(size_t)l*n_samp]);
+      sumall += etar[l];
+    }
+    for (l = 0; l < n_dim; l++)
+      Xbeta[i+(size_t)l*n_samp] = (d->w && d->w[i] == 0) ? 0 :
+	(Y[i] == l+1) - etar[l]/sumall;
+  }
+  for (l = 0; l < n_dim; l++)
+    DesignXty(d, Xbeta + (size_t)l*n_samp, grad + l*n_cov);
+
+  for (main_loop = 0; main_loop < n_gen; main_loop++) {
+    for (j = 0; j < n_dim; j++)
+      for (k = 0; k < n_cov; k++) {
+	/** Sample from the proposal distribution **/
+	diff = norm_rand()*sqrt(Var[j*n_cov+k]);
+	prop[j*n_cov+k] = beta[j*n_cov+k] + diff;
+	rate = 0;
+	for (l = 0; l < n_dim; l++)
+	  for (m = 0; m < n_cov; m++)
+	    rate += bound[m]*fmax2(fabs(beta[l*n_cov+m]-ref[l*n_cov+m]),
+				   fabs(prop[l*n_cov+m]-ref[l*n_cov+m]));
+	rate *= bound[k]*fabs(diff)/4;
+	
+	/** prior **/
+	numer = dMVN(prop, beta0, A0, n_cov*n_dim, 1);
+	denom = dMVN(beta, beta0, A0, n_cov*n_dim, 1);   
+	if (rate > 1) { /* full pass over the obs where column k is
+			   nonzero; the others do not change */
+	  if (!synced) {
+	    for (l = 0; l < n_dim; l++)
+	      DesignXBeta(d, 0, n_cov, beta + l*n_cov,
+			  Xbeta + (size_t)l*n_samp);
+	    for (l = 0; l < n_cov*n_dim; l++)
+	      beta1[l] = beta[l];
+	    synced = 1;
+	  }
+	  /* the moves accepted since the last full pass */
+	  for (l = 0; l < n_dim; l++)
+	    for (m = 0; m < n_cov; m++)
+	      if (beta[l*n_cov+m] != beta1[l*n_cov+m]) {
+		dtemp = beta[l*n_cov+m] - beta1[l*n_cov+m];
+		n_nz = DesignNonzero(d, m, idx, x);
+		for (i = 0; i < n_nz; i++)
+		  Xbeta[idx[i]+(size_t)l*n_samp] += x[i]*dtemp;
+		beta1[l*n_cov+m] = beta[l*n_cov+m];
+	      }
+	  n_nz = DesignNonzero(d, k, idx, x);
+	  for (m = 0; m < n_nz; m++) {
+	    i = idx[m];
+	    if (d->w && d->w[i] == 0)
+	      continue;
+	    for (l = 0; l < n_dim; l++)
+	      eta[l] = Xbeta[i+(size_t)l*n_samp];
+	    denom += logitLik(Y[i], eta, n_dim);
+	    eta[j] += x[m]*diff;
+	    numer += logitLik(Y[i], eta, n_dim);
+	  }
+	  accept = (unif_rand() < fmin2(1.0, exp(numer-denom)));
+	  if (accept) {
+	    for (m = 0; m < n_nz; m++)
+	      Xbeta[idx[m]+(size_t)j*n_samp] += x[m]*diff;
+	    beta1[j*n_cov+k] = prop[j*n_cov+k];
+	  }
+	} else { /* thinned Poisson process of rejections */
+	  numer += grad[j*n_cov+k]*diff;
+	  accept = (unif_rand() < fmin2(1.0, exp(numer-denom)));
+	  n_pois = accept ? (int)rpois(rate*n_samp) : 0;
+	  while (accept && n_pois-- > 0) {
+	    i = (int)(unif_rand()*n_samp);
+	    if (i == n_samp)
+	      i--;
+	    if (d->w && d->w[i] == 0)
+	      continue;
+	    DesignRow(d, i, xi);
+	    sumall = 1.0;
+	    for (l = 0; l < n_dim; l++) {
+	      eta[l] = etar[l] = 0;
+	      for (m = 0; m < n_cov; m++) {
+		eta[l] += xi[m]*beta[l*n_cov+m];
+		etar[l] += xi[m]*ref[l*n_cov+m];
+	      }
+	      sumall += exp(etar[l]);
+	    }
+	    /* phi_i(beta) - phi_i(prop) */
+	    dtemp = logitLik(Y[i], eta, n_dim) + 
+	      ((Y[i] == j+1) - exp(etar[j])/sumall)*xi[k]*diff;
+	    eta[j] += xi[k]*diff;
+	    dtemp -= logitLik(Y[i], eta, n_dim);
+	    if (unif_rand()*rate < dtemp)
+	      accept = 0;
+	  }
+	}
+
+	/** Rejection **/
+	if (accept) {
+	  counter[j*n_cov+k]++;
+	  beta[j*n_cov+k] = prop[j*n_cov+k];
+	} else
+	  prop[j*n_cov+k] = beta[j*n_cov+k];
+      }
+  }
+  
+  free(bound);
+  free(grad);
+  free(prop);
+  free(eta);
+  free(etar);
+  free(xi);
+  free(Xbeta);
+  free(beta1);
+  free(idx);
+  free(x);
+} /* end of logitMetroSub */
+
+
+/*** 
+   Posterior Modes for Starting Values
+
+   bGLMMode: binary probit (logit = 0) or logistic (logit = 1)
+   regression of Y[i] == level on the column-major design d (see
+   design.c) with the prior N(beta0, A0^{-1}),
+   by Fisher scoring from the given beta; only the obs with use[i] = 1
+   enter (all of them if use is NULL).  The iterations stop early
+   once the step is small, and a step that leaves the finite numbers,
+   e.g., under separation with an improper prior, is not taken.
+
+   bNormalMode: least squares of Y on d with the prior of d added as
+   in bNormalRegCol; sig2 is the residual variance of the data rows,
+   which may be weighted by 0 or 1 as there.
+***/
+
+void bGLMMode(int *Y,        /* outcome variable */
+	      colDesign *d,  /* covariates */
+	      double *beta,  /* coefficients; starting values on input */
+	      int level,     /* value of Y coded as one */
+	      int *use,      /* obs to use; NULL for all */
+	      int logit,     /* logistic (1) or probit (0) link */
+	      double *beta0, /* prior mean */
+	      double **A0,   /* prior precision */
+	      int n_iter     /* maximum # of iterations */
+	      ) {
+  int i, j, k, iter, ok, n_samp = d->n_samp, n_cov = d->n_cov;
+  double p, step;
+  double *score = doubleArray(n_cov);
+  double *prop = doubleArray(n_cov);
+  double **info = doubleMatrix(n_cov, n_cov);
+  double **V = doubleMatrix(n_cov, n_cov);
+  /* linear predictors, then the weights and scores of the obs */
+  double *eta = doubleArray(n_samp);
+  double *u = doubleArray(n_samp);
+  double *XX = doubleArray(n_cov*n_cov);
+
+  for (iter = 0; iter < n_iter; iter++) {
+    DesignXBeta(d, 0, n_cov, beta, eta);
+    for (i = 0; i < n_samp; i++) {
+      if (use && !use[i]) {
+	eta[i] = 0; u[i] = 0;
+      } else if (logit) {
+	p = 1/(1+exp(-eta[i]));
+	u[i] = (Y[i] == level) - p;
+	eta[i] = p*(1-p);
+      } else {
+	p = fmin2(fmax2(pnorm(eta[i], 0, 1, 1, 0), 1e-10), 1-1e-10);
+	eta[i] = dnorm(eta[i], 0, 1, 0);
+	u[i] = eta[i]*((Y[i] == level) - p)/(p*(1-p));
+	eta[i] = eta[i]*eta[i]/(p*(1-p));
+      }
+    }
+    DesignXty(d, u, score);
+    DesignCross(d, eta, XX);
+    for (j = 0; j < n_cov; j++)
+      for (k = 0; k < n_cov; k++) {
+	info[j][k] = A0[j][k] + XX[j+k*n_cov];
+	score[j] -= A0[j][k]*(beta[k]-beta0[k]);
+      }
+
+    dinv(info, n_cov, V);
+    ok = 1; step = 0;
+    for (j = 0; j < n_cov; j++) {
+      prop[j] = beta[j];
+      for (k = 0; k < n_cov; k++)
+	prop[j] += V[j][k]*score[k];
+      if (!R_FINITE(prop[j]))
+	ok = 0;
+      step = fmax2(step, fabs(prop[j]-beta[j]));
+    }
+    if (!ok)
+      break;
+    for (j = 0; j < n_cov; j++)
+      beta[j] = prop[j];
+    if (step < 1e-6)
+      break;
+  }
+
+  free(score);
+  free(prop);
+  FreeMatrix(info, n_cov);
+  FreeMatrix(V, n_cov);
+  free(eta);
+  free(u);
+  free(XX);
+} /* end of bGLMMode */
+
+void bNormalMode(double *Y,     /* outcome variable */
+		 colDesign *d,  /* covariates and prior */
+		 double *beta,  /* coefficients */
+		 double *sig2   /* variance */
+		 ) {
+  int i, j, n_samp = d->n_samp, n_cov = d->n_cov;
+  double dtemp;
+  double **SS = doubleMatrix(n_cov+1, n_cov+1);
+  double *eta = doubleArray(n_samp);
+
+  DesignSS(d, Y, SS);
+  for (j = 0; j < n_cov; j++)
+    SWP(SS, j, n_cov+1);
+  for (j = 0; j < n_cov; j++)
+    beta[j] = SS[j][n_cov];
+
+  DesignXBeta(d, 0, n_cov, beta, eta);
+  *sig2 = 0;
+  for (i = 0; i < n_samp; i++)
+    if (!d->w || d->w[i] != 0) {
+      dtemp = Y[i] - eta[i];
+      *sig2 += dtemp*dtemp;
+    }
+  *sig2 = fmax2(*sig2/DesignUnits(d), 1e-10);
+
+  FreeMatrix(SS, n_cov+1);
+  free(eta);
+} /* end of bNormalMode */
+
+
 
 /*** 
    A Standard Gibbs Sampler for Normal Mixed Effects Regression
@@ -1,14 +1,27 @@
+#include "design.h"
+
 /* normal regression */
 void bNormalReg(double **D, double *beta, double *sig2, 
 		int n_samp, int n_cov, int addprior, int pbeta, 
 		double *beta0, double **A0, int psig2, double s0, 
 		int nu0, int sig2fixed);
   
+/* normal regression on a column-major design */
+void bNormalRegCol(double *Y, colDesign *d, double *beta, double *sig2,
+		   int pbeta, int psig2, double s0, int nu0, int sig2fixed);
+
 /* binomial probit regression */
 void bprobitGibbs(int *Y, double **X, double *beta, int n_samp, 
 		  int n_cov, int prior, double *beta0, double **A0, 
 		  int mda, int n_gen);
 
+/* binomial probit regression on a column-major design */
+void bprobitGibbsCol(int *Y, colDesign *d, double *beta, int mda,
+		     int n_gen);
+double bprobitLatent(double eta, int k, int y, double sig2, double *WW);
+void bprobitDrawCol(colDesign *d, double *W, double WW, int n_unit,
+		    double *beta, int mda, double sig2);
+
 /* ordinal probit regression */
 void boprobitMCMC(int *Y, double **X, double *beta, 
 		  double *tau, int n_samp, int n_cov, int n_cat, 
@@ -20,6 +33,21 @@ void logitMetro(int *Y, double **X, double *beta, int n_samp,
 		int n_dim, int n_cov, double *beta0, double **A0,     
 		double *Var, int n_gen, int *counter);
 
+/* logitMetro on a column-major design */
+void logitMetroCol(int *Y, colDesign *d, double *beta, int n_dim,
+		   double *beta0, double **A0, double *Var, int n_gen,
+		   int *counter);
+
+/* logitMetroCol evaluating a random subset of the obs at each move */
+void logitMetroSub(int *Y, colDesign *d, double *beta, double *ref,
+		   int n_dim, double *beta0, double **A0, double *Var,
+		   int n_gen, int *counter);
+
+/* posterior modes of the binary and normal regressions */
+void bGLMMode(int *Y, colDesign *d, double *beta, int level, int *use,
+	      int logit, double *beta0, double **A0, int n_iter);
+void bNormalMode(double *Y, colDesign *d, double *beta, double *sig2);
+
 /* Normal mixed effects regression */
 void bNormalMixedGibbs(double *Y, double **X, double ***Zgrp,
 		       int *grp, double *beta, double **gamma, double *sig2,    
@@ -0,0 +1,147 @@
+/****
+
+     This file contains the convergence monitor used to stop a
+     sampler early: the kept draws of its quantities of interest are
+     reduced to batch means on the fly, from which the batch means
+     estimate of the effective sample size and the split R-hat of
+     Gelman et al. (2013) are computed.  With one chain, the R-hat
+     compares the first and second halves of the full batches.  The
+     sampler stops once the smallest effective sample size reaches
+     the target and the largest R-hat is below its threshold.
+
+****/
+
+#include <stdlib.h>
+#include <math.h>
+#include <Rmath.h>
+#include <R.h>
+#include "vector.h"
+#include "monitor.h"
+
+
+convMonitor *MonOpen(int n_qoi, double ess, double rhat) {
+  int k;
+  convMonitor *m = (convMonitor *)malloc(sizeof(convMonitor));
+
+  m->n_qoi = n_qoi;
+  m->ess = ess;
+  m->rhat = rhat;
+  m->n = 0;
+  m->size = 1;
+  m->n_batch = 0;
+  m->n_cur = 0;
+  m->sum = doubleArray(n_qoi*(MON_BATCH+1));
+  m->ss = doubleArray(n_qoi*(MON_BATCH+1));
+  for (k = 0; k < n_qoi*(MON_BATCH+1); k++)
+    m->sum[k] = m->ss[k] = 0;
+  m->min_ess = 0;
+  m->max_rhat = R_PosInf;
+  return m;
+} /* end of MonOpen */
+
+
+/* Effective sample size and split R-hat of quantity q from the full
+   batches */
+static void MonStat(convMonitor *m, int q, double *ess, double *rhat) {
+  int b, h, nb = m->n_batch, nh = m->n_batch/2;
+  double *sum = m->sum + q*(MON_BATCH+1), *ss = m->ss + q*(MON_BATCH+1);
+  double n = (double)nb*m->size, mean = 0, var = 0, bvar = 0;
+  double hn = (double)nh*m->size, hmean[2], hvar[2], W, B;
+
+  for (b = 0; b < nb; b++) {
+    mean += sum[b];
+    var += ss[b];
+  }
+  mean /= n;
+  var = (var - n*mean*mean)/(n-1);
+  for (b = 0; b < nb; b++)
+    bvar += (sum[b]/m->size - mean)*(sum[b]/m->size - mean);
+  bvar *= (double)m->size/(nb-1);
+  *ess = (bvar > 0) ? n*var/bvar : n;
+
+  for (h = 0; h < 2; h++) {
+    hmean[h] = hvar[h] = 0;
+    for (b = h*nh; b < (h+1)*nh; b++) {
+      hmean[h] += sum[b];
+      hvar[h] += ss[b];
+    }
+    hmean[h] /= hn;
+    hvar[h] = (hvar[h] - hn*hmean[h]*hmean[h])/(hn-1);
+  }
+  W = (hvar[0]+hvar[1])/2;
+  B = hn*(hmean[0]-hmean[1])*(hmean[0]-hmean[1])/2;
+  *rhat = (W > 0) ? sqrt(((hn-1)/hn*W + B/hn)/W) : 1;
+} /* end of MonStat */
+
+
+/* Add a kept draw; returns 1 when the targets are met */
+int MonAdd(convMonitor *m, double *x) {
+  int q, b;
+  double *sum, *ss, ess, rhat;
+
+  m->n++;
+  for (q = 0; q < m->n_qoi; q++) {
+    m->sum[q*(MON_BATCH+1)+MON_BATCH] += x[q];
+    m->ss[q*(MON_BATCH+1)+MON_BATCH] += x[q]*x[q];
+  }
+  if (++m->n_cur < m->size)
+    return 0;
+
+  /* the current batch is full */
+  for (q = 0; q < m->n_qoi; q++) {
+    sum = m->sum + q*(MON_BATCH+1);
+    ss = m->ss + q*(MON_BATCH+1);
+    sum[m->n_batch] = sum[MON_BATCH];
+    ss[m->n_batch] = ss[MON_BATCH];
+    sum[MON_BATCH] = ss[MON_BATCH] = 0;
+  }
+  m->n_batch++;
+  m->n_cur = 0;
+  if (m->n_batch == MON_BATCH) { /* merge pairs of batches */
+    for (q = 0; q < m->n_qoi; q++) {
+      sum = m->sum + q*(MON_BATCH+1);
+      ss = m->ss + q*(MON_BATCH+1);
+      for (b = 0; b < MON_BATCH/2; b++) {
+	sum[b] = sum[2*b] + sum[2*b+1];
+	ss[b] = ss[2*b] + ss[2*b+1];
+      }
+    }
+    m->n_batch = MON_BATCH/2;
+    m->size *= 2;
+  }
+  if (m->n_batch < MON_BATCH/2 || m->n_batch % 2)
+    return 0;
+
+  /* check the targets */
+  m->min_ess = R_PosInf;
+  m->max_rhat = 0;
+  for (q = 0; q < m->n_qoi; q++) {
+    MonStat(m, q, &ess, &rhat);
+    m->min_ess = fmin2(m->min_ess, ess);
+    m->max_rhat = fmax2(m->max_rhat, rhat);
+  }
+  return (m->min_ess >= m->ess) && (m->max_rhat <= m->rhat);
+} /* end of MonAdd */
+
+
+/* Write out the status as MON_SIZE doubles (see monitor.h) */
+void MonWrite(convMonitor *m, int stopped, int n_iter, double *out) {
+  out[0] = stopped;
+  out[1] = n_iter;
+  out[2] = m->n;
+  out[3] = m->min_ess;
+  out[4] = m->max_rhat;
+} /* end of MonWrite */
+
+
+void MonClose(convMonitor *m) {
+  free(m->sum);
+  free(m->ss);
+  free(m);
+} /* end of MonClose */
+
+
+/* Length of the status, called from R to allocate the output */
+void MonSize(int *size) {
+  *size = MON_SIZE;
+}
@@ -0,0 +1,30 @@
+/* # of batches kept by the convergence monitor; even */
+#define MON_BATCH 64
+/* length of the status written by MonWrite(): whether the run
+   stopped because the targets were met, # of iterations, # of kept
+   draws, the smallest effective sample size, and the largest R-hat */
+#define MON_SIZE 5
+
+/* online convergence monitor of the quantities of interest: the kept
+   draws are grouped into at most MON_BATCH batches, whose size
+   doubles whenever they are all full */
+typedef struct {
+  int n_qoi;        /* # of quantities */
+  double ess;       /* target effective sample size */
+  double rhat;      /* largest acceptable split R-hat */
+  int n;            /* # of kept draws */
+  int size;         /* # of draws in a batch */
+  int n_batch;      /* # of full batches */
+  int n_cur;        /* # of draws in the current batch */
+  double *sum;      /* sums and sums of squares of the draws in each */
+  double *ss;       /* batch; MON_BATCH+1 per quantity, the last one
+		       is the current batch */
+  double min_ess;   /* at the last check */
+  double max_rhat;
+} convMonitor;
+
+convMonitor *MonOpen(int n_qoi, double ess, double rhat);
+int MonAdd(convMonitor *m, double *x);
+void MonWrite(convMonitor *m, int stopped, int n_iter, double *out);
+void MonClose(convMonitor *m);
+void MonSize(int *size);
@@ -0,0 +1,100 @@
+/****
+
+     This file contains the instrumentation of the samplers: the wall
+     clock time spent in each phase of an iteration and counters of
+     events in the subroutines (see profile.h).  A sampler calls
+     ProfReset() before its first iteration and ProfPhase() whenever
+     it enters a phase, so that the clock is read once per phase, and
+     writes out the profile with ProfWrite().  A run resumed from a
+     checkpoint is profiled on its own: the counters start from zero
+     and the acceptances restored from the checkpoint are not
+     counted.
+
+****/
+
+#include <time.h>
+#include <R.h>
+#include "profile.h"
+
+profState prof;
+
+
+/* wall clock time in seconds */
+static double ProfTime(void) {
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec;
+#else
+  return (double)clock()/CLOCKS_PER_SEC;
+#endif
+}
+
+
+void ProfReset(void) {
+  int k;
+
+  for (k = 0; k < PROF_N_PHASE; k++) {
+    prof.time[k] = 0;
+    prof.calls[k] = 0;
+    prof.alloc[k] = 0;
+  }
+  for (k = 0; k < PROF_N_COUNT; k++)
+    prof.count[k] = 0;
+  prof.phase = -1;
+} /* end of ProfReset */
+
+
+/* Leave the current phase and enter the next one; -1 stops the clock */
+void ProfPhase(int phase) {
+  double now = ProfTime();
+
+  if (prof.phase >= 0)
+    prof.time[prof.phase] += now - prof.start;
+  prof.phase = phase;
+  prof.start = now;
+  if (phase >= 0)
+    prof.calls[phase]++;
+} /* end of ProfPhase */
+
+
+/* Subtract the acceptance counters of a Metropolis sampler at the
+   start of a run, which are not zero if restored from a checkpoint;
+   ProfAccept() then adds those at the end */
+void ProfAcceptStart(int *accept, int n) {
+  int k;
+
+  for (k = 0; k < n; k++)
+    prof.count[PROF_ACCEPT] -= accept[k];
+}
+
+
+/* Add the acceptance counters of a Metropolis sampler */
+void ProfAccept(int *accept, int n) {
+  int k;
+
+  for (k = 0; k < n; k++)
+    prof.count[PROF_ACCEPT] += accept[k];
+}
+
+
+/* Write out the profile as PROF_SIZE doubles (see profile.h) */
+void ProfWrite(double *out) {
+  int k;
+
+  ProfPhase(-1);
+  for (k = 0; k < PROF_N_PHASE; k++) {
+    out[k] = prof.time[k];
+    out[PROF_N_PHASE+k] = prof.calls[k];
+    out[2*PROF_N_PHASE+k] = prof.alloc[k];
+  }
+  for (k = 0; k < PROF_N_COUNT; k++)
+    out[3*PROF_N_PHASE+k] = prof.count[k];
+} /* end of ProfWrite */
+
+
+/* Length of a profile, called from R to allocate the output */
+void ProfSize(int *size) {
+  *size = PROF_SIZE;
+}
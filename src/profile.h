@@ -0,0 +1,40 @@
+/* phases of an iteration timed by the samplers */
+#define PROF_RESPONSE 0     /* response model */
+#define PROF_COMPLIANCE 1   /* compliance model */
+#define PROF_LATENT 2       /* compliance types or missing outcomes */
+#define PROF_OUTCOME 3      /* outcome model */
+#define PROF_PROB 4         /* probabilities of the observed data */
+#define PROF_QOI 5          /* quantities of interest */
+#define PROF_STORE 6        /* storing draws, checkpoints, and printing */
+#define PROF_N_PHASE 7
+
+/* counters */
+#define PROF_TRUNCNORM 0    /* draws from TruncNorm() */
+#define PROF_REJECT 1       /* rejected proposals in TruncNorm() */
+#define PROF_ACCEPT 2       /* accepted Metropolis proposals */
+#define PROF_SWP 3          /* calls to SWP() */
+#define PROF_ALLOC 4        /* arrays allocated in vector.c */
+#define PROF_N_COUNT 5
+
+/* length of the profile written by ProfWrite(): seconds spent in, #
+   of entries to, and # of arrays allocated in each phase, and the
+   counters */
+#define PROF_SIZE (3*PROF_N_PHASE + PROF_N_COUNT)
+
+typedef struct {
+  double time[PROF_N_PHASE];
+  double calls[PROF_N_PHASE];
+  double alloc[PROF_N_PHASE];
+  double count[PROF_N_COUNT];
+  int phase;                  /* current phase; -1 if none */
+  double start;               /* time when the phase was entered */
+} profState;
+
+extern profState prof;
+
+void ProfReset(void);
+void ProfPhase(int phase);
+void ProfAcceptStart(int *accept, int n);
+void ProfAccept(int *accept, int n);
+void ProfWrite(double *out);
+void ProfSize(int *size);
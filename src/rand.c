@@ -7,6 +7,7 @@
 #include "vector.h"
 #include "subroutines.h"
 #include "rand.h"
+#include "profile.h"
 
 /* Multivariate Normal density */
 double dMVN(
@@ -54,6 +55,7 @@ double TruncNorm(
   double stub = (ub-mu)/sigma;  /* standardized upper bound */
   if(stlb >= stub)
     error("TruncNorm: lower bound is greater than upper bound\n");
+  prof.count[PROF_TRUNCNORM]++;
   if (invcdf) {  /* inverse cdf method */
     z = qnorm(runif(pnorm(stlb, 0, 1, 1, 0), pnorm(stub, 0, 1, 1, 0)),
 	      0, 1, 1, 0); 
@@ -77,7 +79,9 @@ double TruncNorm(
 	M=exp(dnorm(stlb,0,1,1) - dexp(stlb,1/exp_par,1));
       else
 	M=exp(dnorm(stub,0,1,1) - dexp(stub,1/exp_par,1));
+      prof.count[PROF_REJECT]--;
       do{ 
+	prof.count[PROF_REJECT]++;
 	u=unif_rand();
 	z=-log(1-u*(pexp(stub,1/exp_par,1,0)-pexp(stlb,1/exp_par,1,0))
 	       -pexp(stlb,1/exp_par,1,0))/exp_par;
@@ -85,8 +89,11 @@ double TruncNorm(
       if(flag==1) z=-z;
     } 
     else{ 
-      do z=norm_rand();
-      while( z<stlb || z>stub ); 
+      prof.count[PROF_REJECT]--;
+      do {
+	prof.count[PROF_REJECT]++;
+	z=norm_rand();
+      } while( z<stlb || z>stub ); 
     }
   }
   return(z*sigma + mu); 
@@ -206,3 +213,75 @@ double rnegbin(double mu,    /* mean */
 	       ) {
   return(rnbinom(theta, theta/(mu+theta)));
 }
+
+
+/* 
+   Random number streams which, unlike R's generator, can be used by
+   several threads at once: xorshift128+ seeded by splitmix64.  A
+   stream is seeded from R's generator, so that the draws are
+   reproducible with set.seed() whatever the # of threads.
+*/
+
+static uint64_t SplitMix(uint64_t *x) {
+  uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+
+  z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+/* seed a stream; call from the main thread */
+void StreamSeed(rngStream *r) {
+  uint64_t x = (uint64_t)(unif_rand()*4294967296.0) << 32 |
+    (uint64_t)(unif_rand()*4294967296.0);
+
+  r->s[0] = SplitMix(&x);
+  r->s[1] = SplitMix(&x);
+}
+
+/* uniform on (0, 1) */
+double StreamUnif(rngStream *r) {
+  uint64_t s1 = r->s[0], s0 = r->s[1];
+
+  r->s[0] = s0;
+  s1 ^= s1 << 23;
+  r->s[1] = s1 ^ s0 ^ (s1 >> 17) ^ (s0 >> 26);
+  return ((double)((r->s[1] + s0) >> 11) + 0.5)/9007199254740992.0;
+}
+
+/* Poisson with mean mu: inversion for small means and the
+   transformed rejection (PTRS) of Hormann (1993) otherwise */
+int StreamPois(rngStream *r, double mu) {
+  int k;
+  double p, F, u, v, us, a, b, invalpha, vr, lmu;
+
+  if (mu <= 0)
+    return 0;
+  if (mu < 10) {
+    p = F = exp(-mu);
+    u = StreamUnif(r);
+    for (k = 0; u > F && k < 1000; k++) {
+      p *= mu/(k+1);
+      F += p;
+    }
+    return k;
+  }
+  lmu = log(mu);
+  b = 0.931 + 2.53*sqrt(mu);
+  a = -0.059 + 0.02483*b;
+  invalpha = 1.1239 + 1.1328/(b-3.4);
+  vr = 0.9277 - 3.6224/(b-2);
+  while (1) {
+    u = StreamUnif(r) - 0.5;
+    v = StreamUnif(r);
+    us = 0.5 - fabs(u);
+    k = (int)floor((2*a/us + b)*u + mu + 0.43);
+    if (us >= 0.07 && v <= vr)
+      return k;
+    if (k < 0 || (us < 0.013 && v > us))
+      continue;
+    if (log(v) + log(invalpha) - log(a/(us*us)+b) <=
+	-mu + k*lmu - lgammafn(k+1))
+      return k;
+  }
+}
@@ -1,6 +1,17 @@
+#include <stdint.h>
+
 double TruncNorm(double lb, double ub, double mu, double var, int invcdf);
 void rMVN(double *Sample, double *mean, double **inv_Var, int size);
 double dMVN(double *Y, double *MEAN, double **SIG_INV, int dim, int give_log);
 void rWish(double **Sample, double **S, int df, int size);
 double dnegbin(int Y, double mu, double theta, int give_log);
 double rnegbin(double mu, double theta);
+
+/* random number streams for threads */
+typedef struct {
+  uint64_t s[2];
+} rngStream;
+
+void StreamSeed(rngStream *r);
+double StreamUnif(rngStream *r);
+int StreamPois(rngStream *r, double mu);
@@ -0,0 +1,271 @@
+/* samplers called from R through the .Call entry points in call.c */
+
+/* latent ignorability models with a binary outcome */
+void LIbinary(int *Y, int *R, int *Z, int *D, int *RD, int *C, int *A,
+	      int *Ymiss, int *AT, int *Insample, double *dXc,
+	      double *dXo, double *dXr, double *betaC, double *betaA,
+	      double *gamma, double *delta, int *in_samp, int *n_gen,
+	      int *in_covC, int *in_covO, int *in_covR, double *beta0,
+	      double *gamma0, double *delta0, double *dA0C,
+	      double *dA0O, double *dA0R, double *VarC, double *VarO,
+	      double *VarR, int *logitC, int *logitO, int *logitR,
+	      int *param, int *mda, int *burnin, int *iKeep,
+	      int *verbose, char **outfile, int *online, char **ckfile,
+	      int *ckevery, int *resume, int *nthread, int *subsample,
+	      int *warm, int *rb, double *ess, double *rhat,
+	      int *single, int *sparse, int *spc_p, int *spc_i,
+	      double *spc_x, int *spo_p, int *spo_i, double *spo_x,
+	      int *spr_p, int *spr_i, double *spr_x, double *coefC,
+	      double *coefA, double *coefO, double *coefR, double *QoI,
+	      double *summary, double *profile, double *conv);
+
+/* latent ignorability models with an ordinal outcome */
+void LIordinal(int *Y, int *R, int *Z, int *D, int *RD, int *C, int *A,
+	       int *Ymiss, int *AT, int *Insample, double *dXc,
+	       double *dXo, double *dXr, double *betaC, double *betaA,
+	       double *gamma, double *tau, double *delta, int *in_samp,
+	       int *n_gen, int *n_cat, int *in_covC, int *in_covO,
+	       int *in_covR, double *beta0, double *gamma0,
+	       double *delta0, double *dA0C, double *dA0O, double *dA0R,
+	       double *VarC, double *VarO, double *VarR, int *logitC,
+	       int *logitR, int *param, int *mda, int *burnin,
+	       int *iKeep, int *verbose, char **outfile, char **ckfile,
+	       int *ckevery, int *resume, int *nthread, int *single,
+	       double *coefC, double *coefA, double *coefO,
+	       double *coefR, double *tauO, double *QoI, double *profile);
+
+/* latent ignorability models with a Gaussian outcome */
+void LIgaussian(double *Y, int *R, int *Z, int *D, int *RD, int *C,
+		int *A, int *Ymiss, int *AT, int *Insample, double *dXc,
+		double *dXo, double *dXr, double *betaC, double *betaA,
+		double *gamma, double *sig2, double *delta,
+		int *in_samp, int *n_gen, int *in_covC, int *in_covO,
+		int *in_covR, double *beta0, double *gamma0,
+		double *delta0, double *dA0C, double *dA0O,
+		double *dA0R, int *nu0, double *s0, double *VarC,
+		double *VarR, int *logitC, int *logitR, int *param,
+		int *mda, int *burnin, int *iKeep, int *verbose,
+		char **outfile, char **ckfile, int *ckevery,
+		int *resume, int *nthread, int *warm, int *rb,
+		double *ess, double *rhat, int *single, int *sparse,
+		int *spc_p, int *spc_i, double *spc_x, int *spo_p,
+		int *spo_i, double *spo_x, int *spr_p, int *spr_i,
+		double *spr_x, double *coefC, double *coefA,
+		double *coefO, double *coefR, double *var, double *QoI,
+		double *profile, double *conv);
+
+/* latent ignorability models with a count outcome */
+void LIcount(int *Y, int *R, int *Z, int *D, int *RD, int *C, int *A,
+	     int *Ymiss, int *AT, int *Insample, double *dXc,
+	     double *dXo, double *dXr, double *betaC, double *betaA,
+	     double *gamma, double *sig2, double *delta, int *in_samp,
+	     int *n_gen, int *in_covC, int *in_covO, int *in_covR,
+	     double *beta0, double *gamma0, double *delta0,
+	     double *dA0C, double *dA0O, double *dA0R, double *a0,
+	     double *b0, double *VarC, double *VarR, double *VarO,
+	     double *VarS, int *logitC, int *logitR, int *param,
+	     int *mda, int *burnin, int *iKeep, int *verbose,
+	     char **outfile, char **ckfile, int *ckevery, int *resume,
+	     int *nthread, int *rb, int *single, double *coefC,
+	     double *coefA, double *coefO, double *coefR, double *var,
+	     double *QoI, double *profile);
+
+/* latent ignorability models with a two-part outcome */
+void LItwopart(int *Y, double *Y1, int *R, int *Z, int *D, int *RD,
+	       int *C, int *A, int *Ymiss, int *AT, int *Insample,
+	       double *dXc, double *dXo, double *dXr, double *betaC,
+	       double *betaA, double *gamma, double *gamma1,
+	       double *sig2, double *delta, int *in_samp, int *n_gen,
+	       int *in_covC, int *in_covO, int *in_covR, double *beta0,
+	       double *gamma0, double *delta0, double *dA0C,
+	       double *dA0O, double *dA0R, int *nu0, double *s0,
+	       double *VarC, double *VarR, int *logitC, int *logitR,
+	       int *param, int *mda, int *burnin, int *iKeep,
+	       int *verbose, char **outfile, char **ckfile,
+	       int *ckevery, int *resume, int *nthread, int *rb,
+	       int *single, double *coefC, double *coefA, double *coefO,
+	       double *coefO1, double *coefR, double *var, double *QoI,
+	       double *profile);
+
+/* missing at random outcomes */
+void MARprobit(int *Y, int *Ymiss, int *iYmax, int *Z, int *D, int *C,
+	       double *dX, double *dXo, double *dBeta, double *dGamma,
+	       int *iNsamp, int *iNgen, int *iNcov, int *iNcovo,
+	       int *iNcovoX, int *iN11, double *beta0, double *gamma0,
+	       double *dA, double *dAo, double *dSprec, int *insample,
+	       int *smooth, int *param, int *mda, int *iBurnin,
+	       int *iKeep, int *verbose, int *online, int *single,
+	       double *ess, double *rhat, double *pdStore,
+	       double *summary, double *profile, double *conv);
+
+/* nonignorable missing binary outcomes and multi-valued treatments */
+void NIbprobit(int *Y, int *R, double *dXo, double *dXr, double *beta,
+	       double *delta, int *insamp, int *incovo, int *incovr,
+	       int *intreat, double *beta0, double *delta0, double *dAo,
+	       double *dAr, int *Insample, int *param, int *mda,
+	       int *ndraws, int *iBurnin, int *iKeep, int *verbose,
+	       int *online, int *single, int *sparse, int *spo_p,
+	       int *spo_i, double *spo_x, int *spr_p, int *spr_i,
+	       double *spr_x, int *compress, int *count, double *ess,
+	       double *rhat, double *coefo, double *coefr, double *ATE,
+	       double *BASE, double *summary, double *profile,
+	       double *conv);
+
+/* mixed effects models for clustered randomized experiments */
+
+/* latent ignorability models with a binary probit outcome */
+void LIbprobitMixed(int *Y, int *R, int *Z, int *D, int *RD, int *C,
+		    int *A, int *grp, int *Ymiss, int *AT,
+		    int *Insample, int *random, double *dXc,
+		    double *dZc, double *dXo, double *dZo, double *dXr,
+		    double *dZr, double *betaC, double *betaA,
+		    double *gamma, double *delta, int *in_samp,
+		    int *n_gen, int *in_grp, int *max_samp_grp,
+		    int *in_fixed, int *in_random, double *dPsiC,
+		    double *dPsiA, double *dPsiO, double *dPsiR,
+		    double *beta0, double *gamma0, double *delta0,
+		    double *dA0C, double *dA0O, double *dA0R,
+		    int *tau0s, double *dT0C, double *dT0A,
+		    double *dT0O, double *dT0R, double *tune_fixed,
+		    double *tune_random, int *logitC, int *param,
+		    int *burnin, int *iKeep, int *verbose,
+		    double *coefC, double *coefA, double *coefO,
+		    double *coefR, double *sPsiC, double *sPsiA,
+		    double *sPsiO, double *sPsiR, double *QoI);
+
+/* latent ignorability models with a Gaussian outcome */
+void LINormalMixed(double *Y, int *R, int *Z, int *D, int *RD, int *C,
+		   int *A, int *grp, int *Ymiss, int *AT, int *Insample,
+		   int *random, double *dXc, double *dZc, double *dXo,
+		   double *dZo, double *dXr, double *dZr, double *betaC,
+		   double *betaA, double *gamma, double *delta,
+		   double *sig2, int *in_samp, int *n_gen, int *in_grp,
+		   int *max_samp_grp, int *in_fixed, int *in_random,
+		   double *dPsiC, double *dPsiA, double *dPsiO,
+		   double *dPsiR, double *beta0, double *gamma0,
+		   double *delta0, double *dA0C, double *dA0O,
+		   double *dA0R, int *nu0, double *s0, int *tau0s,
+		   double *dT0C, double *dT0A, double *dT0O,
+		   double *dT0R, double *tune_fixed,
+		   double *tune_random, int *logitC, int *param,
+		   int *burnin, int *iKeep, int *verbose, double *coefC,
+		   double *coefA, double *coefO, double *coefR,
+		   double *ssig2, double *sPsiC, double *sPsiA,
+		   double *sPsiO, double *sPsiR, double *QoI);
+
+/* latent ignorability models with an ordinal probit outcome */
+void LIboprobitMixed(int *Y, int *R, int *Z, int *D, int *RD, int *C,
+		     int *A, int *grp, int *Ymiss, int *AT,
+		     int *Insample, int *random, double *dXc,
+		     double *dZc, double *dXo, double *dZo, double *dXr,
+		     double *dZr, double *betaC, double *betaA,
+		     double *gamma, double *tau, double *delta,
+		     int *in_samp, int *in_cat, int *n_gen, int *in_grp,
+		     int *max_samp_grp, int *in_fixed, int *in_random,
+		     double *dPsiC, double *dPsiA, double *dPsiO,
+		     double *dPsiR, double *beta0, double *gamma0,
+		     double *delta0, double *dA0C, double *dA0O,
+		     double *dA0R, int *tau0s, double *dT0C,
+		     double *dT0A, double *dT0O, double *dT0R,
+		     double *tune_fixed, double *tune_random,
+		     double *tune_tau, int *mh, int *logitC, int *param,
+		     int *burnin, int *iKeep, int *verbose,
+		     double *coefC, double *coefA, double *coefO,
+		     double *coefR, double *tauO, double *sPsiC,
+		     double *sPsiA, double *sPsiO, double *sPsiR,
+		     double *QoI);
+
+/* latent ignorability models with a negative binomial outcome */
+void LINegBinMixed(int *Y, int *R, int *Z, int *D, int *RD, int *C,
+		   int *A, int *grp, int *Ymiss, int *AT, int *Insample,
+		   int *random, double *dXc, double *dZc, double *dXo,
+		   double *dZo, double *dXr, double *dZr, double *betaC,
+		   double *betaA, double *gamma, double *delta,
+		   double *sig2, int *in_samp, int *n_gen,
+		   int *max_samp_grp, int *in_fixed, int *in_random,
+		   double *dPsiC, double *dPsiA, double *dPsiO,
+		   double *dPsiR, double *beta0, double *gamma0,
+		   double *delta0, double *dA0C, double *dA0O,
+		   double *dA0R, double *a0, double *b0, int *tau0s,
+		   double *dT0C, double *dT0A, double *dT0O,
+		   double *dT0R, double *tune_fixed,
+		   double *tune_random, double *varb, double *varg,
+		   double *vars, int *logitC, int *param, int *burnin,
+		   int *iKeep, int *verbose, double *coefC,
+		   double *coefA, double *coefO, double *coefR,
+		   double *ssig2, double *sPsiC, double *sPsiA,
+		   double *sPsiO, double *sPsiR, double *QoI);
+
+/* latent ignorability models with a two-part outcome */
+void LItwopartMixed(int *Y, double *Y1, int *R, int *Z, int *D, int *RD,
+		    int *C, int *A, int *grp, int *Ymiss, int *Insample,
+		    int *random, double *dXc, double *dZc, double *dXo,
+		    double *dZo, double *dXr, double *dZr,
+		    double *betaC, double *betaA, double *gamma,
+		    double *delta, double *sig2, int *in_samp,
+		    int *n_gen, int *in_grp, int *max_samp_grp,
+		    int *in_fixed, int *in_random, double *dPsiC,
+		    double *dPsiA, double *dPsiO, double *dPsiR,
+		    double *beta0, double *gamma0, double *delta0,
+		    double *dA0C, double *dA0O, double *dA0R, int *nu0,
+		    double *s0, int *tau0s, double *dT0C, double *dT0A,
+		    double *dT0O, double *dT0R, double *tune_fixed,
+		    double *tune_random, int *logitC, int *param,
+		    int *burnin, int *iKeep, int *verbose,
+		    double *coefC, double *coefA, double *coefO,
+		    double *coefO1, double *coefR, double *ssig2,
+		    double *sPsiC, double *sPsiA, double *sPsiO,
+		    double *sPsiO1, double *sPsiR, double *QoI);
+
+/* nonignorable missing binary outcomes and multi-valued treatments */
+void NIbprobitMixed(int *Y, int *R, int *grp, int *in_grp,
+		    int *max_samp_grp, double *dXo, double *dXr,
+		    double *dZo, double *dZr, double *beta,
+		    double *delta, double *dPsio, double *dPsir,
+		    int *insamp, int *incovo, int *incovr, int *incovoR,
+		    int *incovrR, int *intreat, double *beta0,
+		    double *delta0, double *dAo, double *dAr, int *dfo,
+		    int *dfr, double *dS0o, double *dS0r, int *Insample,
+		    int *param, int *mda, int *ndraws, int *iBurnin,
+		    int *iKeep, int *verbose, double *coefo,
+		    double *coefr, double *sPsiO, double *sPsiR,
+		    double *ATE, double *BASE);
+
+/* Poisson bootstrap of the bounds on the ATE with missing outcomes */
+void boundsBoot(int *arm, int *stratum, int *count, double *Ymin,
+		double *Ymax, double *survey, int *n_cell, int *n_arm,
+		int *n_strata, double *ratio, int *fix_ratio, int *agg,
+		int *n_reps, int *n_thread, double *reps);
+
+/* bounds on the ATE aggregated over strata */
+void boundsAgg(int *arm, int *stratum, double *Ymin, double *Ymax,
+	       double *weights, double *survey, int *n_samp, int *n_arm,
+	       int *n_strata, double *ratio, int *fix_ratio,
+	       double *bounds);
+
+/* sup of the empirical CDFs of the B-method */
+void boundsSup(double *bmin, double *bmax, int *n_reps, double *bsup);
+
+/* bootstrap of the ATOP bounds under the matched-pairs design */
+void atopBoot(int *n_pair, int *start, double *cnt, double *y1,
+	      double *y0, int *n_cls, int *n_reps, int *n_thread,
+	      double *reps);
+
+/* AUPEC of scores: sums, variances and covariance terms of each */
+void aupecStat(double *tau, int *T, double *Y, int *n_samp, int *n_rule,
+	       int *n_thread, double *stat);
+
+/* PAPE and PAPD of rules: counts, sums and variances of each */
+void papeStat(int *T, double *Y, int *H, int *G, int *n_samp, int *n_rule,
+	      int *has_g, double *plim, int *n_thread, double *stat);
+
+/* moments of the units of each cluster by treatment assignment */
+void clusterMoments(int *id, int *Z, double *D, double *Y, double *A,
+		    int *n_samp, int *n_cluster, double *mom, double *Aj,
+		    double *bad);
+
+/* bread and meats of the sandwich variances of CADEreg */
+void cadeRegMeat(int *id, int *Z, double *A, double *W, double *M,
+		 double *res, int *n_samp, int *n_cluster, int *n_cov,
+		 double *MM, double *clu, double *clu_hc2, double *ind,
+		 double *hc2);
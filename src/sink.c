@@ -0,0 +1,267 @@
+/****
+
+     This file contains the output sink which streams the kept draws
+     of a sampler to a binary file instead of R vectors.  Each kept
+     draw is one record made of named blocks (e.g., QoI, coefC), and
+     records are written in chunks.  Alternatively, the draws are
+     summarized on the fly (see sketch.c) and nothing is written until
+     the sink is closed.
+
+     File layout (native byte order):
+       char[8]   "EXPDRAWS"
+       int       version, # of blocks, record length, # of records
+       per block: char[16] name, int length
+       records of doubles
+
+****/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <R.h>
+#include "vector.h"
+#include "sink.h"
+
+#define SINK_MAGIC "EXPDRAWS"
+#define SINK_VERSION 1
+/* a chunk holds about this many doubles */
+#define SINK_CHUNK_SIZE 65536
+
+/* offset of the # of records in the header */
+#define SINK_NREC_OFFSET (8 + 3*sizeof(int))
+
+
+/* Open a sink; blocks are added with SinkBlock() and the file is
+   created by SinkStart() or reopened by SinkResume() */
+drawSink *SinkOpen(const char *file) {
+  drawSink *sink = (drawSink *)malloc(sizeof(drawSink));
+
+  if (!sink)
+    error("Out of memory error in SinkOpen\n");
+  sink->file = (char *)malloc(strlen(file)+1);
+  if (!sink->file)
+    error("Out of memory error in SinkOpen\n");
+  strcpy(sink->file, file);
+  sink->fp = NULL;
+  sink->summary = NULL;
+  sink->sketch = NULL;
+  sink->n_block = 0;
+  sink->rec_width = 0;
+  sink->chunk = 0;
+  sink->buf = NULL;
+  sink->n_buf = 0;
+  sink->n_rec = 0;
+  return sink;
+} /* end of SinkOpen */
+
+
+/* Open a sink which summarizes each value of a record; the summaries
+   are written to summary (SKETCH_SIZE doubles per value) when the sink
+   is closed */
+drawSink *SinkSummary(double *summary) {
+  drawSink *sink = (drawSink *)malloc(sizeof(drawSink));
+
+  if (!sink)
+    error("Out of memory error in SinkSummary\n");
+  sink->file = NULL;
+  sink->fp = NULL;
+  sink->summary = summary;
+  sink->sketch = NULL;
+  sink->n_block = 0;
+  sink->rec_width = 0;
+  sink->chunk = 0;
+  sink->buf = NULL;
+  sink->n_buf = 0;
+  sink->n_rec = 0;
+  return sink;
+} /* end of SinkSummary */
+
+
+/* Add a block to the record and return the storage for one draw */
+double *SinkBlock(drawSink *sink, const char *name, int width) {
+  int k = sink->n_block;
+
+  if (k == SINK_MAX_BLOCK)
+    error("SinkBlock: too many blocks.\n");
+  strncpy(sink->name[k], name, SINK_NAME_LEN-1);
+  sink->name[k][SINK_NAME_LEN-1] = '\0';
+  sink->width[k] = width;
+  sink->block[k] = doubleArray(width > 0 ? width : 1);
+  sink->rec_width += width;
+  sink->n_block++;
+  return sink->block[k];
+} /* end of SinkBlock */
+
+
+/* Close the file before raising an error, which does not return */
+static void SinkAbort(drawSink *sink) {
+  if (sink->fp) {
+    fclose(sink->fp);
+    sink->fp = NULL;
+  }
+}
+
+
+/* fwrite with error check */
+static void SinkWrite(drawSink *sink, const void *ptr, size_t size,
+		      size_t n) {
+  if (fwrite(ptr, size, n, sink->fp) != n) {
+    SinkAbort(sink);
+    error("SinkWrite: writing to the output file failed.\n");
+  }
+}
+
+
+/* Allocate the chunk buffer */
+static void SinkBuffer(drawSink *sink) {
+  sink->chunk = SINK_CHUNK_SIZE/(sink->rec_width > 0 ? sink->rec_width : 1);
+  if (sink->chunk < 1)
+    sink->chunk = 1;
+  sink->buf = doubleArray(sink->chunk*(sink->rec_width > 0 ? sink->rec_width : 1));
+}
+
+
+/* Create the file and write the header; called once all blocks are
+   added */
+void SinkStart(drawSink *sink) {
+  int k;
+  int header[4];
+
+  if (sink->summary) {
+    sink->sketch = (qSketch *)malloc((sink->rec_width > 0 ? sink->rec_width : 1)
+				     * sizeof(qSketch));
+    if (!sink->sketch)
+      error("Out of memory error in SinkStart\n");
+    for (k = 0; k < sink->rec_width; k++)
+      SketchInit(&(sink->sketch[k]));
+    return;
+  }
+
+  sink->fp = fopen(sink->file, "wb");
+  if (!sink->fp)
+    error("SinkStart: cannot open %s for writing.\n", sink->file);
+  header[0] = SINK_VERSION;
+  header[1] = sink->n_block;
+  header[2] = sink->rec_width;
+  header[3] = 0;
+  SinkWrite(sink, SINK_MAGIC, 1, 8);
+  SinkWrite(sink, header, sizeof(int), 4);
+  for (k = 0; k < sink->n_block; k++) {
+    SinkWrite(sink, sink->name[k], 1, SINK_NAME_LEN);
+    SinkWrite(sink, &(sink->width[k]), sizeof(int), 1);
+  }
+  SinkBuffer(sink);
+} /* end of SinkStart */
+
+
+/* Reopen an existing file with the same blocks and continue after
+   its first n_rec records; any later records are overwritten */
+void SinkResume(drawSink *sink) {
+  int k, width;
+  int header[4];
+  char magic[8], name[SINK_NAME_LEN];
+  long offset;
+
+  sink->fp = fopen(sink->file, "r+b");
+  if (!sink->fp)
+    error("SinkResume: cannot open %s.\n", sink->file);
+  if (fread(magic, 1, 8, sink->fp) != 8 || memcmp(magic, SINK_MAGIC, 8) != 0 ||
+      fread(header, sizeof(int), 4, sink->fp) != 4 ||
+      header[0] != SINK_VERSION || header[1] != sink->n_block ||
+      header[2] != sink->rec_width) {
+    SinkAbort(sink);
+    error("SinkResume: %s is not a file of draws from this sampler.\n",
+	  sink->file);
+  }
+  for (k = 0; k < sink->n_block; k++)
+    if (fread(name, 1, SINK_NAME_LEN, sink->fp) != SINK_NAME_LEN ||
+	fread(&width, sizeof(int), 1, sink->fp) != 1 ||
+	strncmp(name, sink->name[k], SINK_NAME_LEN) != 0 ||
+	width != sink->width[k]) {
+      SinkAbort(sink);
+      error("SinkResume: %s is not a file of draws from this sampler.\n",
+	    sink->file);
+    }
+  offset = ftell(sink->fp) + (long)sink->n_rec*sink->rec_width*sizeof(double);
+  if (fseek(sink->fp, offset, SEEK_SET) != 0) {
+    SinkAbort(sink);
+    error("SinkResume: cannot seek in %s.\n", sink->file);
+  }
+  SinkBuffer(sink);
+} /* end of SinkResume */
+
+
+/* Flush the records in the chunk buffer */
+static void SinkFlush(drawSink *sink) {
+  if (sink->n_buf > 0) {
+    SinkWrite(sink, sink->buf, sizeof(double),
+	      (size_t)sink->n_buf*sink->rec_width);
+    sink->n_buf = 0;
+  }
+}
+
+
+/* Append the current draw stored in the blocks as a record */
+void SinkCommit(drawSink *sink) {
+  int j, k, l;
+  double *rec;
+
+  if (sink->summary) {
+    for (k = 0, l = 0; k < sink->n_block; k++)
+      for (j = 0; j < sink->width[k]; j++)
+	SketchAdd(&(sink->sketch[l++]), sink->block[k][j]);
+    sink->n_rec++;
+    return;
+  }
+  rec = sink->buf + (size_t)sink->n_buf*sink->rec_width;
+  for (k = 0; k < sink->n_block; k++) {
+    memcpy(rec, sink->block[k], sink->width[k]*sizeof(double));
+    rec += sink->width[k];
+  }
+  sink->n_buf++;
+  sink->n_rec++;
+  if (sink->n_buf == sink->chunk)
+    SinkFlush(sink);
+} /* end of SinkCommit */
+
+
+/* Write out all records committed so far, e.g., before a checkpoint */
+void SinkSync(drawSink *sink) {
+  if (sink->summary)
+    return;
+  SinkFlush(sink);
+  if (fflush(sink->fp) != 0) {
+    SinkAbort(sink);
+    error("SinkSync: writing to the output file failed.\n");
+  }
+} /* end of SinkSync */
+
+
+/* Flush the remaining records, record their number, and close; a
+   summarizing sink writes out its sketches instead */
+void SinkClose(drawSink *sink) {
+  int k;
+
+  if (sink->summary) {
+    for (k = 0; k < sink->rec_width; k++) {
+      SketchWrite(&(sink->sketch[k]), sink->summary + (size_t)k*SKETCH_SIZE);
+      SketchFree(&(sink->sketch[k]));
+    }
+    free(sink->sketch);
+  }
+  else {
+    SinkFlush(sink);
+    if (fseek(sink->fp, SINK_NREC_OFFSET, SEEK_SET) != 0) {
+      SinkAbort(sink);
+      error("SinkClose: cannot update the header.\n");
+    }
+    SinkWrite(sink, &(sink->n_rec), sizeof(int), 1);
+    fclose(sink->fp);
+    free(sink->file);
+  }
+
+  for (k = 0; k < sink->n_block; k++)
+    free(sink->block[k]);
+  free(sink->buf);
+  free(sink);
+} /* end of SinkClose */
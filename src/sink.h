@@ -0,0 +1,33 @@
+#include <stdio.h>
+#include "sketch.h"
+
+/* maximum number of blocks in a record and length of a block name */
+#define SINK_MAX_BLOCK 8
+#define SINK_NAME_LEN 16
+
+/* output sink for the kept draws of a sampler; the draws are either
+   written to a file or summarized by one sketch per value */
+typedef struct {
+  char *file;                      /* NULL when summarizing */
+  FILE *fp;
+  double *summary;                 /* output for the sketches */
+  qSketch *sketch;                 /* one per value in a record */
+  int n_block;                     /* # of blocks in a record */
+  char name[SINK_MAX_BLOCK][SINK_NAME_LEN];
+  int width[SINK_MAX_BLOCK];       /* length of each block */
+  double *block[SINK_MAX_BLOCK];   /* storage for the current draw */
+  int rec_width;                   /* length of a record */
+  int chunk;                       /* # of records in a chunk */
+  double *buf;                     /* chunk buffer */
+  int n_buf;                       /* # of records in the buffer */
+  int n_rec;                       /* # of records written */
+} drawSink;
+
+drawSink *SinkOpen(const char *file);
+drawSink *SinkSummary(double *summary);
+double *SinkBlock(drawSink *sink, const char *name, int width);
+void SinkStart(drawSink *sink);
+void SinkResume(drawSink *sink);
+void SinkCommit(drawSink *sink);
+void SinkSync(drawSink *sink);
+void SinkClose(drawSink *sink);
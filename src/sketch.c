@@ -0,0 +1,156 @@
+/****
+
+     This file contains the one-pass summary of a quantity used when
+     the kept draws of a sampler are summarized rather than stored:
+     Welford's running mean and variance, and a merging t-digest
+     (Dunning and Ertl) for the quantiles.  Values are buffered and
+     merged into the centroids with the scale function
+     k(q) = delta/(2 pi) asin(2q - 1), so that the centroids are small
+     in the tails and the memory does not grow with the # of draws.
+     Quantiles are computed in R from the centroids written out by
+     SketchWrite().
+
+****/
+
+#include <stdlib.h>
+#include <math.h>
+#include <Rmath.h>
+#include <R.h>
+#include "vector.h"
+#include "sketch.h"
+
+
+/* scale function and its inverse */
+static double SketchK(double q) {
+  return SKETCH_DELTA/(2*M_PI)*asin(2*q-1);
+}
+
+static double SketchQ(double k) {
+  if (k >= SKETCH_DELTA/4.0)
+    return 1;
+  return (sin(2*M_PI*k/SKETCH_DELTA)+1)/2;
+}
+
+
+void SketchInit(qSketch *s) {
+  s->n = 0;
+  s->mean = 0;
+  s->M2 = 0;
+  s->min = R_PosInf;
+  s->max = R_NegInf;
+  s->n_cent = 0;
+  s->cmean = doubleArray(SKETCH_CAP);
+  s->cwt = doubleArray(SKETCH_CAP);
+  s->n_buf = 0;
+  s->buf = doubleArray(SKETCH_BUF);
+} /* end of SketchInit */
+
+
+/* Merge the buffered values into the centroids */
+static void SketchMerge(qSketch *s) {
+  int i, m, n = s->n_cent + s->n_buf;
+  int *index;
+  double *value, *weight;
+  double wsofar = 0, limit, cm, cw, w;
+
+  if (s->n_buf == 0)
+    return;
+  index = intArray(n);
+  value = doubleArray(n);
+  weight = doubleArray(n);
+  for (i = 0; i < s->n_cent; i++) {
+    value[i] = s->cmean[i];
+    weight[i] = s->cwt[i];
+  }
+  for (i = 0; i < s->n_buf; i++) {
+    value[s->n_cent+i] = s->buf[i];
+    weight[s->n_cent+i] = 1;
+  }
+  for (i = 0; i < n; i++)
+    index[i] = i;
+  rsort_with_index(value, index, n);
+
+  /* a centroid may grow until its weight reaches the limit implied
+     by one unit of k beyond its left edge */
+  limit = s->n*SketchQ(SketchK(0)+1);
+  m = 0;
+  cm = value[0]; cw = weight[index[0]];
+  for (i = 1; i < n; i++) {
+    w = weight[index[i]];
+    if (wsofar + cw + w <= limit) {
+      cw += w;
+      cm += (value[i]-cm)*w/cw;
+    }
+    else {
+      if (m == SKETCH_CAP) { /* not reached with the scale above */
+	s->cwt[m-1] += cw;
+	s->cmean[m-1] += (cm-s->cmean[m-1])*cw/s->cwt[m-1];
+      }
+      else {
+	s->cmean[m] = cm; s->cwt[m++] = cw;
+      }
+      wsofar += cw;
+      limit = s->n*SketchQ(SketchK(wsofar/s->n)+1);
+      cm = value[i]; cw = w;
+    }
+  }
+  if (m == SKETCH_CAP) {
+    s->cwt[m-1] += cw;
+    s->cmean[m-1] += (cm-s->cmean[m-1])*cw/s->cwt[m-1];
+  }
+  else {
+    s->cmean[m] = cm; s->cwt[m++] = cw;
+  }
+  s->n_cent = m;
+  s->n_buf = 0;
+
+  free(index);
+  free(value);
+  free(weight);
+} /* end of SketchMerge */
+
+
+/* Add a value */
+void SketchAdd(qSketch *s, double x) {
+  double d = x - s->mean;
+
+  s->n++;
+  s->mean += d/s->n;
+  s->M2 += d*(x - s->mean);
+  if (x < s->min) s->min = x;
+  if (x > s->max) s->max = x;
+  s->buf[s->n_buf++] = x;
+  if (s->n_buf == SKETCH_BUF)
+    SketchMerge(s);
+} /* end of SketchAdd */
+
+
+/* Write out the summary as SKETCH_SIZE doubles (see sketch.h) */
+void SketchWrite(qSketch *s, double *out) {
+  int i;
+
+  SketchMerge(s);
+  out[0] = s->n;
+  out[1] = s->mean;
+  out[2] = s->n > 1 ? sqrt(s->M2/(s->n-1)) : NA_REAL;
+  out[3] = s->min;
+  out[4] = s->max;
+  out[5] = (double)s->n_cent;
+  for (i = 0; i < SKETCH_CAP; i++) {
+    out[6+i] = i < s->n_cent ? s->cmean[i] : 0;
+    out[6+SKETCH_CAP+i] = i < s->n_cent ? s->cwt[i] : 0;
+  }
+} /* end of SketchWrite */
+
+
+void SketchFree(qSketch *s) {
+  free(s->cmean);
+  free(s->cwt);
+  free(s->buf);
+} /* end of SketchFree */
+
+
+/* Length of a sketch, called from R to allocate the output */
+void SketchSize(int *size) {
+  *size = SKETCH_SIZE;
+}
@@ -0,0 +1,27 @@
+/* compression of the quantile sketch; larger values are more accurate */
+#define SKETCH_DELTA 200
+/* maximum # of centroids and # of values buffered before merging */
+#define SKETCH_CAP 400
+#define SKETCH_BUF 500
+/* length of a sketch written out by SketchWrite():
+   n, mean, sd, min, max, # of centroids, means[CAP], weights[CAP] */
+#define SKETCH_SIZE (6 + 2*SKETCH_CAP)
+
+/* running moments and a (merging) t-digest of one quantity */
+typedef struct {
+  double n;         /* # of values */
+  double mean;      /* running mean */
+  double M2;        /* running sum of squared deviations */
+  double min, max;
+  int n_cent;       /* # of centroids */
+  double *cmean;    /* centroid means in increasing order */
+  double *cwt;      /* centroid weights */
+  int n_buf;        /* # of buffered values */
+  double *buf;
+} qSketch;
+
+void SketchInit(qSketch *s);
+void SketchAdd(qSketch *s, double x);
+void SketchWrite(qSketch *s, double *out);
+void SketchFree(qSketch *s);
+void SketchSize(int *size);
@@ -8,6 +8,7 @@
 #include <R_ext/Lapack.h>
 #include "vector.h"
 #include "rand.h"
+#include "profile.h"
 
 /*  The Sweep operator */
 void SWP(
@@ -17,6 +18,7 @@ void SWP(
 {
   int i,j;
 
+  prof.count[PROF_SWP]++;
   if (X[k][k] < 10e-20) 
     error("SWP: singular matrix.\n");
   else
@@ -113,3 +115,48 @@ double ddet(double **X, int size, int give_log)
   else
     return(exp(2.0*logdet));
 }
+
+
+/* Cholesky decomposition of a symmetric positive definite band matrix
+   with b subdiagonals, stored as X[i][k] = X(i, i-k), k = 0, ..., b;
+   X is overwritten by its lower triangular factor in the same layout */
+void dcholBand(double **X, int size, int b)
+{
+  int i, j, k, l;
+  double dtemp;
+
+  for (i = 0; i < size; i++)
+    for (k = (i < b ? i : b); k >= 0; k--) {
+      j = i-k;
+      dtemp = X[i][k];
+      for (l = (i > b ? i-b : 0); l < j; l++)
+	dtemp -= X[i][i-l]*X[j][j-l];
+      if (k > 0)
+	X[i][k] = dtemp/X[j][0];
+      else if (dtemp > 0)
+	X[i][0] = sqrt(dtemp);
+      else
+	error("dcholBand: the matrix is not positive definite.\n");
+    }
+}
+
+
+/* solves L x = y (trans = 0) or L' x = y (trans = 1) for the band
+   factor L of dcholBand; x holds y on input */
+void solveBand(double **L, int size, int b, double *x, int trans)
+{
+  int i, k;
+
+  if (trans)
+    for (i = size-1; i >= 0; i--) {
+      for (k = 1; k <= b && i+k < size; k++)
+	x[i] -= L[i+k][k]*x[i+k];
+      x[i] /= L[i][0];
+    }
+  else
+    for (i = 0; i < size; i++) {
+      for (k = 1; k <= b && k <= i; k++)
+	x[i] -= L[i][k]*x[i-k];
+      x[i] /= L[i][0];
+    }
+}
@@ -3,3 +3,5 @@ void SWP( double **X, int k, int size);
 void dinv(double **X, int size, double **X_inv);
 void dcholdc(double **X, int size, double **L);
 double ddet(double **X, int size, int give_log);
+void dcholBand(double **X, int size, int b);
+void solveBand(double **L, int size, int b, double *x, int trans);
@@ -3,9 +3,29 @@
 #include <stdio.h>
 #include <R_ext/Utils.h>
 #include <R.h>
+#include "profile.h"
 
-int* intArray(int num) {
+/* count the allocations for the profile of the samplers, in total
+   and in the current phase; arrays may be allocated by several
+   threads */
+static void CountAlloc(int n) {
+  int phase = prof.phase;
+
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+  prof.count[PROF_ALLOC] += n;
+  if (phase >= 0) {
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+    prof.alloc[phase] += n;
+  }
+}
+
+int* intArray(size_t num) {
   int *iArray = (int *)malloc(num * sizeof(int));
+  CountAlloc(1);
   if (!iArray)
     error("Out of memory error in intArray\n");
   return iArray;
@@ -20,6 +40,7 @@ void PintArray(int *ivector, int length) {
 int** intMatrix(int row, int col) {
   int i;
   int **iMatrix = (int **)malloc(row * sizeof(int *));
+  CountAlloc(row+1);
   if (!iMatrix) 
     error("Out of memory error in intMatrix\n");
   for (i = 0; i < row; i++) {
@@ -40,8 +61,9 @@ void PintMatrix(int **imatrix, int row, int col) {
 }
 
 
-double* doubleArray(int num) {
+double* doubleArray(size_t num) {
   double *dArray = (double *)malloc(num * sizeof(double));
+  CountAlloc(1);
   if (!dArray)
     error("Out of memory error in doubleArray\n");
   return dArray;
@@ -56,6 +78,7 @@ void PdoubleArray(double *dvector, int length) {
 double** doubleMatrix(int row, int col) {
   int i;
   double **dMatrix = (double **)malloc((size_t)(row * sizeof(double *)));
+  CountAlloc(row+1);
   if (!dMatrix) 
     error("Out of memory error in doubleMatrix\n");
   for (i = 0; i < row; i++) {
@@ -78,6 +101,7 @@ void PdoubleMatrix(double **dmatrix, int row, int col) {
 double*** doubleMatrix3D(int x, int y, int z) {
   int i;
   double ***dM3 = (double ***)malloc(x * sizeof(double **));
+  CountAlloc(1);
   if (!dM3) 
     error("Out of memory error in doubleMatrix3D\n");
   for (i = 0; i < x; i++) 
@@ -97,8 +121,9 @@ void PdoubleMatrix3D(double ***dmatrix3D, int x, int y, int z) {
   }
 }
 
-long* longArray(int num) {
+long* longArray(size_t num) {
   long *lArray = (long *)malloc(num * sizeof(long));
+  CountAlloc(1);
   if (!lArray)
     error("Out of memory error in longArray\n");
   return lArray;